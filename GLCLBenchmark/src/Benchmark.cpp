@@ -0,0 +1,334 @@
+#include "glclpch.h"
+#include "Benchmark.h"
+
+#include "Engine/Time.h"
+#include "Engine/Compute/OpenCLContext.h"
+#include "Engine/Threading/JobSystem.h"
+#include "Particle/Simd/ParticleKernels.h"
+
+#include <ctime>
+#include <iomanip>
+
+namespace Benchmark
+{
+	using namespace Engine;
+
+	const char* BackendName(SimulationBackend backend)
+	{
+		switch (backend)
+		{
+		case SimulationBackend::OpenCL: return "opencl";
+		case SimulationBackend::CPU: return "cpu";
+		}
+
+		return "unknown";
+	}
+
+	// Nearest-rank percentile over an already sorted sample set.
+	static double Percentile(const std::vector<double>& sorted, double percentile)
+	{
+		if (sorted.empty())
+			return 0.0;
+
+		size_t rank = (size_t)std::ceil(percentile / 100.0 * sorted.size());
+		return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+	}
+
+	// text as the inside of a JSON string: quotes, backslashes and control characters escaped.
+	static std::string EscapeJSON(const std::string& text)
+	{
+		std::string escaped;
+		escaped.reserve(text.size());
+		for (char c : text)
+		{
+			switch (c)
+			{
+			case '"': escaped += "\\\""; break;
+			case '\\': escaped += "\\\\"; break;
+			case '\n': escaped += "\\n"; break;
+			case '\r': escaped += "\\r"; break;
+			case '\t': escaped += "\\t"; break;
+			default:
+				if ((unsigned char)c < 0x20)
+				{
+					char code[8];
+					snprintf(code, sizeof(code), "\\u%04x", (unsigned char)c);
+					escaped += code;
+				}
+				else
+					escaped += c;
+			}
+		}
+		return escaped;
+	}
+
+	// Quoted CSV field, RFC 4180: the text in quotes, any quote inside doubled.
+	static std::string QuoteCSV(const std::string& text)
+	{
+		std::string quoted = "\"";
+		for (char c : text)
+			quoted += c == '"' ? "\"\"" : std::string(1, c);
+		return quoted + "\"";
+	}
+
+	BenchmarkRunner::BenchmarkRunner(const BenchmarkSettings& settings)
+		:m_Settings(settings)
+	{
+		bool wantsOpenCL = std::find(settings.Backends.begin(), settings.Backends.end(), SimulationBackend::OpenCL) != settings.Backends.end();
+		if (wantsOpenCL)
+		{
+			m_OpenCLAvailable = OpenCLContext::Initialize(false, settings.MultiDevice);
+			if (!m_OpenCLAvailable)
+				LOG_WARN("No usable OpenCL device -- skipping OpenCL configurations.");
+		}
+	}
+
+	std::vector<BenchmarkConfig> BenchmarkRunner::BuildSweep() const
+	{
+		std::vector<BenchmarkConfig> sweep;
+
+		for (SimulationBackend backend : m_Settings.Backends)
+		{
+			if (backend == SimulationBackend::OpenCL && !m_OpenCLAvailable)
+				continue;
+
+			for (size_t particleCount : m_Settings.ParticleCounts)
+			{
+				// Local work size only means something to the OpenCL backend, and autotuned runs pick their own.
+				if (backend == SimulationBackend::CPU || m_Settings.Autotune)
+				{
+					sweep.push_back({ particleCount, 0, backend });
+					continue;
+				}
+
+				for (uint32_t localWorkSize : m_Settings.LocalWorkSizes)
+				{
+					if (localWorkSize == 0 || particleCount % localWorkSize != 0)
+					{
+						LOG_WARN("Skipping local work size {} -- does not divide {} particles.", localWorkSize, particleCount);
+						continue;
+					}
+
+					sweep.push_back({ particleCount, localWorkSize, backend });
+				}
+			}
+		}
+
+		return sweep;
+	}
+
+	std::vector<BenchmarkResult> BenchmarkRunner::Run()
+	{
+		std::vector<BenchmarkResult> results;
+
+		for (const BenchmarkConfig& config : BuildSweep())
+		{
+			LOG_INFO("Running {} particles, local size {}, backend {}.", config.ParticleCount, config.LocalWorkSize, BackendName(config.Backend));
+
+			BenchmarkResult result = RunConfig(config);
+			LOG_INFO("  median {:.3f} ms, p95 {:.3f} ms, p99 {:.3f} ms, {:.3f} Gparticles/s, {:.2f} GB/s",
+				result.MedianMS, result.P95MS, result.P99MS, result.ParticlesPerSecond / 1e9, result.BytesPerSecond / 1e9);
+
+			results.push_back(result);
+		}
+
+		return results;
+	}
+
+	BenchmarkResult BenchmarkRunner::RunConfig(const BenchmarkConfig& config)
+	{
+		ParticleSystemProperties properties(config.ParticleCount);
+		properties.Backend = config.Backend;
+		properties.Headless = true;
+		properties.NeighborSearch = m_Settings.NeighborSearch;
+		properties.ReorderInterval = m_Settings.ReorderInterval;
+		properties.Seed = m_Settings.Seed;
+		properties.FastMath = m_Settings.FastMath;
+		properties.BuildOptions = m_Settings.BuildOptions;
+		properties.Substeps = m_Settings.Substeps;
+		properties.ShaderColor = m_Settings.ShaderColor;
+		properties.MultiDevice = m_Settings.MultiDevice;
+		properties.Autotune = m_Settings.Autotune;
+		if (config.LocalWorkSize > 0)
+			properties.LocalWorkSize = config.LocalWorkSize;
+
+		ParticleSystem* particleSystem = new ParticleSystem(properties, m_Settings.KernelPath, "");
+		particleSystem->Start();
+
+		std::vector<double> samples;
+		samples.reserve((size_t)m_Settings.Iterations * m_Settings.Repeats);
+
+		OpenCLProfiler* profiler = particleSystem->GetProfiler();
+
+		for (uint32_t repeat = 0; repeat < m_Settings.Repeats; repeat++)
+		{
+			// Warm-up commands are kept out of the device timings.
+			if (profiler)
+				profiler->SetEnabled(false);
+
+			for (uint32_t i = 0; i < m_Settings.WarmupIterations; i++)
+			{
+				Time::Tick();
+				particleSystem->Tick(Time::DeltaTime());
+			}
+			particleSystem->Synchronize();
+
+			if (profiler)
+				profiler->SetEnabled(true);
+
+			for (uint32_t i = 0; i < m_Settings.Iterations; i++)
+			{
+				Time::Tick();
+
+				auto start = std::chrono::high_resolution_clock::now();
+				particleSystem->Tick(Time::DeltaTime());
+				particleSystem->Synchronize();
+				auto end = std::chrono::high_resolution_clock::now();
+
+				std::chrono::duration<double, std::milli> elapsed = end - start;
+				samples.push_back(elapsed.count());
+			}
+		}
+
+		BenchmarkResult result;
+		result.Config = config;
+		result.BytesPerStep = particleSystem->GetBytesPerStep();
+		if (config.Backend == SimulationBackend::OpenCL)
+		{
+			result.LocalWorkSize = particleSystem->GetLocalWorkSize();
+			result.ParticlesPerItem = particleSystem->GetParticlesPerItem();
+		}
+
+		if (config.Backend == SimulationBackend::CPU)
+			result.Device = std::string("CPU ") + ParticleKernels::ISAName(ParticleKernels::DetectISA()) + " x" + std::to_string(JobSystem::GetConcurrency());
+		else
+			result.Device = OpenCLContext::GetDeviceName();
+
+		if (profiler)
+		{
+			result.DeviceCommands = profiler->GetStats();
+			result.DeviceKernelMS = samples.empty() ? 0.0 : profiler->GetKernelTime() * 1000.0 / samples.size();
+			result.DeviceBytesPerSecond = result.DeviceKernelMS > 0.0 ? result.BytesPerStep / (result.DeviceKernelMS / 1000.0) : 0.0;
+		}
+
+		delete particleSystem;
+
+		std::sort(samples.begin(), samples.end());
+		double sum = 0.0;
+		for (double sample : samples)
+			sum += sample;
+
+		result.Samples = samples.size();
+		result.MinMS = samples.empty() ? 0.0 : samples.front();
+		result.MaxMS = samples.empty() ? 0.0 : samples.back();
+		result.MeanMS = samples.empty() ? 0.0 : sum / samples.size();
+		result.MedianMS = Percentile(samples, 50.0);
+		result.P95MS = Percentile(samples, 95.0);
+		result.P99MS = Percentile(samples, 99.0);
+
+		double medianSeconds = result.MedianMS / 1000.0;
+		result.ParticlesPerSecond = medianSeconds > 0.0 ? config.ParticleCount / medianSeconds : 0.0;
+		result.BytesPerSecond = medianSeconds > 0.0 ? result.BytesPerStep / medianSeconds : 0.0;
+
+		return result;
+	}
+
+	void BenchmarkReport::WriteJSON(const std::string& filePath, const BenchmarkSettings& settings, const std::vector<BenchmarkResult>& results)
+	{
+		std::ofstream out(filePath);
+		if (!out)
+		{
+			LOG_ERROR("Unable to open benchmark JSON output: {}", filePath);
+			return;
+		}
+
+		std::time_t now = std::time(nullptr);
+		char timestamp[32];
+		std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+		out << std::setprecision(6) << std::fixed;
+		out << "{\n";
+		out << "  \"timestamp\": \"" << timestamp << "\",\n";
+		out << "  \"warmupIterations\": " << settings.WarmupIterations << ",\n";
+		out << "  \"iterations\": " << settings.Iterations << ",\n";
+		out << "  \"repeats\": " << settings.Repeats << ",\n";
+		out << "  \"neighborSearch\": " << (settings.NeighborSearch ? "true" : "false") << ",\n";
+		out << "  \"reorderInterval\": " << settings.ReorderInterval << ",\n";
+		out << "  \"seed\": " << settings.Seed << ",\n";
+		out << "  \"fastMath\": " << (settings.FastMath ? "true" : "false") << ",\n";
+		out << "  \"buildOptions\": \"" << EscapeJSON(settings.BuildOptions) << "\",\n";
+		out << "  \"substeps\": " << settings.Substeps << ",\n";
+		out << "  \"shaderColor\": " << (settings.ShaderColor ? "true" : "false") << ",\n";
+		out << "  \"multiDevice\": " << (settings.MultiDevice ? "true" : "false") << ",\n";
+		out << "  \"autotune\": " << (settings.Autotune ? "true" : "false") << ",\n";
+		out << "  \"results\": [\n";
+
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const BenchmarkResult& r = results[i];
+			out << "    {\n";
+			out << "      \"backend\": \"" << BackendName(r.Config.Backend) << "\",\n";
+			out << "      \"device\": \"" << EscapeJSON(r.Device) << "\",\n";
+			out << "      \"particleCount\": " << r.Config.ParticleCount << ",\n";
+			out << "      \"localWorkSize\": " << r.LocalWorkSize << ",\n";
+			out << "      \"particlesPerItem\": " << r.ParticlesPerItem << ",\n";
+			out << "      \"samples\": " << r.Samples << ",\n";
+			out << "      \"minMS\": " << r.MinMS << ",\n";
+			out << "      \"meanMS\": " << r.MeanMS << ",\n";
+			out << "      \"medianMS\": " << r.MedianMS << ",\n";
+			out << "      \"p95MS\": " << r.P95MS << ",\n";
+			out << "      \"p99MS\": " << r.P99MS << ",\n";
+			out << "      \"maxMS\": " << r.MaxMS << ",\n";
+			out << "      \"bytesPerStep\": " << r.BytesPerStep << ",\n";
+			out << "      \"particlesPerSecond\": " << r.ParticlesPerSecond << ",\n";
+			out << "      \"bytesPerSecond\": " << r.BytesPerSecond << ",\n";
+			out << "      \"deviceKernelMS\": " << r.DeviceKernelMS << ",\n";
+			out << "      \"deviceBytesPerSecond\": " << r.DeviceBytesPerSecond << ",\n";
+			out << "      \"deviceCommands\": [";
+
+			size_t command = 0;
+			for (const auto& entry : r.DeviceCommands)
+			{
+				const CLCommandStats& stats = entry.second;
+				if (stats.Count == 0)
+					continue;
+				out << (command++ > 0 ? "," : "") << "\n";
+				out << "        { \"name\": \"" << EscapeJSON(entry.first) << "\", \"type\": \"" << CLCommandTypeName(stats.Type) << "\""
+					<< ", \"count\": " << stats.Count << ", \"meanMS\": " << stats.GetMeanMS() << ", \"minMS\": " << stats.MinMS << ", \"maxMS\": " << stats.MaxMS
+					<< ", \"queuedToSubmitMS\": " << (stats.Count > 0 ? stats.SumQueuedToSubmitMS / stats.Count : 0.0)
+					<< ", \"submitToStartMS\": " << (stats.Count > 0 ? stats.SumSubmitToStartMS / stats.Count : 0.0)
+					<< ", \"bandwidthGBs\": " << stats.GetBandwidthGBs() << ", \"histogramLog2US\": [";
+
+				for (size_t bucket = 0; bucket < CLCommandStats::HistogramBuckets; bucket++)
+					out << (bucket > 0 ? ", " : "") << stats.Histogram[bucket];
+				out << "] }";
+			}
+
+			out << (command == 0 ? "" : "\n      ") << "]\n";
+			out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+		}
+
+		out << "  ]\n";
+		out << "}\n";
+	}
+
+	void BenchmarkReport::WriteCSV(const std::string& filePath, const std::vector<BenchmarkResult>& results)
+	{
+		std::ofstream out(filePath);
+		if (!out)
+		{
+			LOG_ERROR("Unable to open benchmark CSV output: {}", filePath);
+			return;
+		}
+
+		out << std::setprecision(6) << std::fixed;
+		out << "backend,device,particle_count,local_work_size,samples,min_ms,mean_ms,median_ms,p95_ms,p99_ms,max_ms,bytes_per_step,particles_per_second,bytes_per_second,device_kernel_ms,device_bytes_per_second\n";
+
+		for (const BenchmarkResult& r : results)
+		{
+			out << BackendName(r.Config.Backend) << "," << QuoteCSV(r.Device) << "," << r.Config.ParticleCount << "," << r.LocalWorkSize << ","
+				<< r.Samples << "," << r.MinMS << "," << r.MeanMS << "," << r.MedianMS << "," << r.P95MS << "," << r.P99MS << "," << r.MaxMS << ","
+				<< r.BytesPerStep << "," << r.ParticlesPerSecond << "," << r.BytesPerSecond << "," << r.DeviceKernelMS << "," << r.DeviceBytesPerSecond << "\n";
+		}
+	}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Particle/ParticleSystem.h"
+
+namespace Benchmark
+{
+	struct BenchmarkConfig
+	{
+		size_t ParticleCount;
+		uint32_t LocalWorkSize;
+		Engine::SimulationBackend Backend;
+	};
+
+	struct BenchmarkSettings
+	{
+		std::vector<size_t> ParticleCounts = { 1024 * 1024, 1024 * 1024 * 4, 1024 * 1024 * 16 };
+		std::vector<uint32_t> LocalWorkSizes = { 32, 64, 128, 256 };
+		std::vector<Engine::SimulationBackend> Backends = { Engine::SimulationBackend::OpenCL, Engine::SimulationBackend::CPU };
+
+		uint32_t WarmupIterations = 10;
+		uint32_t Iterations = 100;
+		uint32_t Repeats = 3;
+		// Rebuild the neighbor grid every OpenCL step, as ParticleSystemProperties::NeighborSearch.
+		bool NeighborSearch = false;
+		// Morton-reorder the particle buffers every n OpenCL steps, as ParticleSystemProperties::ReorderInterval.
+		uint32_t ReorderInterval = 0;
+		// Fixed so every configuration starts from the same spawn.  0 draws a new seed per run.
+		uint32_t Seed = 1;
+		// OpenCL kernel specialization, as ParticleSystemProperties::FastMath and BuildOptions.
+		bool FastMath = false;
+		std::string BuildOptions;
+		// Integration steps per tick, as ParticleSystemProperties::Substeps.
+		uint32_t Substeps = 1;
+		// Leave the color to the vertex shader, as ParticleSystemProperties::ShaderColor.
+		bool ShaderColor = false;
+		// Put every device of the OpenCL platform in the context and split the particles across
+		// them, as ParticleSystemProperties::MultiDevice.
+		bool MultiDevice = false;
+		// Let each configuration tune its own launch shape, as ParticleSystemProperties::Autotune.
+		// Replaces the local work size sweep.
+		bool Autotune = false;
+
+		std::string KernelPath = "resources/cl/particle_sim.cl";
+		// Where built OpenCL programs are cached between runs.  Empty rebuilds from source every time.
+		std::string BinaryCacheDirectory = ".clcache";
+		std::string JsonPath = "benchmark.json";
+		std::string CsvPath = "benchmark.csv";
+	};
+
+	struct BenchmarkResult
+	{
+		BenchmarkConfig Config;
+		std::string Device;
+
+		size_t Samples;
+		double MinMS;
+		double MeanMS;
+		double MedianMS;
+		double P95MS;
+		double P99MS;
+		double MaxMS;
+
+		// The step's launch shape as run, which differs from the config's when autotuned.
+		uint32_t LocalWorkSize = 0;
+		uint32_t ParticlesPerItem = 1;
+
+		size_t BytesPerStep;
+		double ParticlesPerSecond;
+		double BytesPerSecond;
+
+		// From OpenCL profiling events over the timed steps.  Empty/zero on the CPU backend.
+		double DeviceKernelMS = 0.0;
+		double DeviceBytesPerSecond = 0.0;
+		std::map<std::string, Engine::CLCommandStats> DeviceCommands;
+	};
+
+	class BenchmarkRunner
+	{
+	public:
+		BenchmarkRunner(const BenchmarkSettings& settings);
+
+		std::vector<BenchmarkResult> Run();
+
+	private:
+		BenchmarkResult RunConfig(const BenchmarkConfig& config);
+		std::vector<BenchmarkConfig> BuildSweep() const;
+
+	private:
+		BenchmarkSettings m_Settings;
+		bool m_OpenCLAvailable = false;
+	};
+
+	class BenchmarkReport
+	{
+	public:
+		static void WriteJSON(const std::string& filePath, const BenchmarkSettings& settings, const std::vector<BenchmarkResult>& results);
+		static void WriteCSV(const std::string& filePath, const std::vector<BenchmarkResult>& results);
+	};
+
+	const char* BackendName(Engine::SimulationBackend backend);
+}
@@ -0,0 +1,130 @@
+#include "glclpch.h"
+#include "Benchmark.h"
+
+#include "Engine/Random.h"
+#include "Engine/Compute/OpenCLContext.h"
+#include "Engine/Compute/OpenCLBinaryCache.h"
+#include "Engine/Threading/JobSystem.h"
+
+template<typename T>
+static std::vector<T> ParseList(const std::string& list, const std::function<T(const std::string&)>& parse)
+{
+	std::vector<T> values;
+	std::stringstream stream(list);
+	std::string item;
+	while (std::getline(stream, item, ','))
+		if (!item.empty())
+			values.push_back(parse(item));
+	return values;
+}
+
+static void PrintUsage()
+{
+	std::cout <<
+		"Usage: GLCLBenchmark [options]\n"
+		"  --counts <n,n,...>       Particle counts to sweep.\n"
+		"  --local <n,n,...>        OpenCL local work sizes to sweep.\n"
+		"  --backends <opencl,cpu>  Backends to sweep.\n"
+		"  --warmup <n>             Warm-up steps before each repeat.\n"
+		"  --iterations <n>         Timed steps per repeat.\n"
+		"  --repeats <n>            Repeats per configuration.\n"
+		"  --neighbors <0|1>        Rebuild the neighbor grid every OpenCL step.\n"
+		"  --reorder <n>            Morton-reorder particle buffers every n OpenCL steps (0 = off).\n"
+		"  --seed <n>               Simulation seed (0 = random per run).\n"
+		"  --fast-math <0|1>        Build the OpenCL kernels with -cl-fast-relaxed-math.\n"
+		"  --build-options <opts>   Extra OpenCL build options, e.g. \"-D NAME=value\".\n"
+		"  --substeps <n>           Integration steps per tick, run in registers by one launch.\n"
+		"  --shader-color <0|1>     Leave the particle color to the vertex shader; the step skips it.\n"
+		"  --multi-device <0|1>     Split the OpenCL step across every device of the platform.\n"
+		"  --autotune <0|1>         Tune each configuration's launch shape instead of sweeping --local.\n"
+		"  --kernel <path>          OpenCL kernel source.\n"
+		"  --cl-cache <dir|off>     OpenCL program binary cache directory.\n"
+		"  --json <path>            JSON report path.\n"
+		"  --csv <path>             CSV report path.\n";
+}
+
+int main(int argc, char** argv)
+{
+	using namespace Engine;
+
+	Benchmark::BenchmarkSettings settings;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--help")
+		{
+			PrintUsage();
+			return 0;
+		}
+
+		if (i + 1 >= argc)
+		{
+			std::cerr << "Missing value for " << arg << "\n";
+			PrintUsage();
+			return 1;
+		}
+
+		std::string value = argv[++i];
+		if (arg == "--counts")
+			settings.ParticleCounts = ParseList<size_t>(value, [](const std::string& s) { return (size_t)std::stoull(s); });
+		else if (arg == "--local")
+			settings.LocalWorkSizes = ParseList<uint32_t>(value, [](const std::string& s) { return (uint32_t)std::stoul(s); });
+		else if (arg == "--backends")
+			settings.Backends = ParseList<SimulationBackend>(value, [](const std::string& s) { return s == "cpu" ? SimulationBackend::CPU : SimulationBackend::OpenCL; });
+		else if (arg == "--warmup")
+			settings.WarmupIterations = (uint32_t)std::stoul(value);
+		else if (arg == "--iterations")
+			settings.Iterations = (uint32_t)std::stoul(value);
+		else if (arg == "--repeats")
+			settings.Repeats = (uint32_t)std::stoul(value);
+		else if (arg == "--neighbors")
+			settings.NeighborSearch = std::stoul(value) != 0;
+		else if (arg == "--reorder")
+			settings.ReorderInterval = (uint32_t)std::stoul(value);
+		else if (arg == "--seed")
+			settings.Seed = (uint32_t)std::stoul(value);
+		else if (arg == "--fast-math")
+			settings.FastMath = std::stoul(value) != 0;
+		else if (arg == "--build-options")
+			settings.BuildOptions = value;
+		else if (arg == "--substeps")
+			settings.Substeps = (uint32_t)std::max<unsigned long>(std::stoul(value), 1);
+		else if (arg == "--shader-color")
+			settings.ShaderColor = std::stoul(value) != 0;
+		else if (arg == "--multi-device")
+			settings.MultiDevice = std::stoul(value) != 0;
+		else if (arg == "--autotune")
+			settings.Autotune = std::stoul(value) != 0;
+		else if (arg == "--kernel")
+			settings.KernelPath = value;
+		else if (arg == "--cl-cache")
+			settings.BinaryCacheDirectory = value == "off" ? "" : value;
+		else if (arg == "--json")
+			settings.JsonPath = value;
+		else if (arg == "--csv")
+			settings.CsvPath = value;
+		else
+		{
+			std::cerr << "Unknown option " << arg << "\n";
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	Log::Initialize();
+	Random::Initialize();
+	JobSystem::Initialize();
+	OpenCLContext::ToggleDebug(true);
+	OpenCLBinaryCache::SetDirectory(settings.BinaryCacheDirectory);
+
+	Benchmark::BenchmarkRunner runner(settings);
+	std::vector<Benchmark::BenchmarkResult> results = runner.Run();
+
+	Benchmark::BenchmarkReport::WriteJSON(settings.JsonPath, settings, results);
+	Benchmark::BenchmarkReport::WriteCSV(settings.CsvPath, results);
+	LOG_INFO("Wrote {} results to {} and {}.", results.size(), settings.JsonPath, settings.CsvPath);
+
+	JobSystem::Shutdown();
+	return 0;
+}
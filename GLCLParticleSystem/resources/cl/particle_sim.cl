@@ -1,7 +1,37 @@
 
-#define SPHERE_COUNT 9
 #define PI 3.14159265359
 
+// Specialized per ParticleSystem with -D options built from ParticleSystemProperties,
+// so the step folds them as constants.  The defaults match the properties' defaults.
+#ifndef SIM_DT
+#define SIM_DT 0.00125f
+#endif
+#ifndef SIM_GRAVITY
+#define SIM_GRAVITY -39.2f
+#endif
+// Steps of SIM_DT per ParticleSimulation launch.
+#ifndef SIM_SUBSTEPS
+#define SIM_SUBSTEPS 1
+#endif
+// 1 when the vertex shader derives the color from the position: the kernels then leave
+// colorBuffer alone, and it may be bound to any buffer.
+#ifndef SIM_SHADER_COLOR
+#define SIM_SHADER_COLOR 0
+#endif
+// 0 when the world has no sphere colliders, which drops the grid lookup from the step.
+#ifndef HAS_COLLIDERS
+#define HAS_COLLIDERS 1
+#endif
+
+// The host steps the same seed to the same bits (CPUParticleSimulation), so nothing may be
+// contracted into an fma, and the step uses +, -, *, / and sqrt only, in the host's order.
+// Built with -cl-fp32-correctly-rounded-divide-sqrt where the device supports it.
+#pragma OPENCL FP_CONTRACT OFF
+
+// Per-substep gravity terms, folded in float exactly as the host computes them.
+#define HALF_G_DT2 (0.5f * SIM_GRAVITY * SIM_DT * SIM_DT)
+#define G_DT (SIM_GRAVITY * SIM_DT)
+
 typedef struct simulation_bounds
 {
 	float4 Center;
@@ -9,19 +39,84 @@ typedef struct simulation_bounds
 	float4 MaxExtent;
 } simulation_bounds;
 
-float random(float3 v)
+// Uniform grid built on the host by ColliderGrid.  Cells hold (first, count) into the index list.
+typedef struct collider_grid
+{
+	float4 Origin;
+	float4 InvCellSize;
+	int4 Dimensions;
+} collider_grid;
+
+// Reset() parameters for InitializeParticles.
+typedef struct particle_spawn
+{
+	float4 Center;
+	float4 MinVelocity;
+	float4 MaxVelocity;
+	float Radius;
+	uint Seed;
+	uint Padding[2];
+} particle_spawn;
+
+// Philox4x32-10, the device twin of Engine::Philox on the host.  Counter layout:
+// x = particle, y = frame (the try, for the spawn), z = stream, w = 0; key = (seed, 0).
+// Same inputs, same bits.
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+// Streams, matching the host constants in CPUParticleSimulation.cpp.
+#define RNG_STREAM_SPAWN 0u
+#define RNG_STREAM_SPAWN_VELOCITY 1u
+#define RNG_STREAM_PULSE 2u
+
+// Spawn tries per particle.  All of them miss the sphere with odds of about 0.48^64, and the
+// particle then starts at the center.
+#define SPAWN_MAX_TRIES 64u
+
+uint4 PhiloxRound(uint4 counter, uint2 key)
+{
+	uint hi0 = mul_hi(PHILOX_M0, counter.x);
+	uint hi1 = mul_hi(PHILOX_M1, counter.z);
+	return (uint4)(hi1 ^ counter.y ^ key.x, PHILOX_M1 * counter.z, hi0 ^ counter.w ^ key.y, PHILOX_M0 * counter.x);
+}
+
+uint4 Philox(uint4 counter, uint2 key)
+{
+	for (int round = 0; round < 9; round++)
+	{
+		counter = PhiloxRound(counter, key);
+		key += (uint2)(PHILOX_W0, PHILOX_W1);
+	}
+	return PhiloxRound(counter, key);
+}
+
+float4 Uniform4(uint seed, uint particle, uint frame, uint stream)
 {
-	float r;
-	float d = dot(v, (float3)(12.9898, 78.233, 1234.343));
-	float s = sin(d) * 43758.5453f;
-	float f = fract(s, &r);
-	return f;
+	uint4 bits = Philox((uint4)(particle, frame, stream, 0u), (uint2)(seed, 0u));
+	return convert_float4(bits >> 8) * (1.0f / 16777216.0f);
+}
+
+float UniformRange(float u, float low, float high)
+{
+	return low + u * (high - low);
+}
+
+// x*x + (y*y + z*z), the host's order.
+float LengthSquared(float3 v)
+{
+	return v.x * v.x + (v.y * v.y + v.z * v.z);
+}
+
+float3 Normalized(float3 v)
+{
+	return v * (1.0f / sqrt(LengthSquared(v)));
 }
 
 bool IsInsideSphere(float4 p, float4 s)
 {
-	float r = fast_length(p.xyz - s.xyz);
-	return r < s.w;
+	return LengthSquared(p.xyz - s.xyz) < s.w * s.w;
 }
 
 bool InColumn(float4 p, simulation_bounds* bounds)
@@ -43,20 +138,45 @@ bool InColumn(float4 p, simulation_bounds* bounds)
 
 float4 ResolveCollision(float3 i, float3 n)
 {
-	i = fast_normalize(i);
-	n = fast_normalize(n);
-	float3 r = i - n * (float3)(2.0 * dot(i, n));
-	return (float4)(r.xyz, 0.0);
+	i = Normalized(i);
+	n = Normalized(n);
+	float twoDot = 2.0f * (i.x * n.x + (i.y * n.y + i.z * n.z));
+	float3 r = i - n * twoDot;
+	return (float4)(r.xyz, 0.0f);
+}
+
+// -1 outside the grid, which also means outside every sphere.
+int ColliderCell(float4 p, global collider_grid* grid)
+{
+	float3 cell = (p.xyz - grid->Origin.xyz) * grid->InvCellSize.xyz;
+	int3 dimensions = grid->Dimensions.xyz;
+
+	if (!(cell.x >= 0.0f && cell.x < dimensions.x && cell.y >= 0.0f && cell.y < dimensions.y && cell.z >= 0.0f && cell.z < dimensions.z))
+		return -1;
+
+	int3 c = convert_int3(cell);
+	return (c.z * dimensions.y + c.y) * dimensions.x + c.x;
 }
 
-float4 UpdateVelocity(float4 p, float4 v, simulation_bounds* bounds, float4* spheresBuffer)
+float4 UpdateVelocity(float4 p, float4 v, simulation_bounds* bounds, float4* spheresBuffer, global collider_grid* grid, global uint2* gridCells, global uint* gridIndices)
 {
 	if (InColumn(p, bounds) && v.y < 0.0f)
 		return v;
 
-	for (int i = 0; i < SPHERE_COUNT; i++)
-		if (IsInsideSphere(p, spheresBuffer[i]))
-			return ResolveCollision(v.xyz, (float3)(p.xyz - spheresBuffer[i].xyz));
+#if HAS_COLLIDERS
+	// Cell lists are ascending, so the lowest-index sphere containing the particle still wins.
+	int cell = ColliderCell(p, grid);
+	if (cell >= 0)
+	{
+		uint2 range = gridCells[cell];
+		for (uint i = range.x; i < range.x + range.y; i++)
+		{
+			float4 sphere = spheresBuffer[gridIndices[i]];
+			if (IsInsideSphere(p, sphere))
+				return ResolveCollision(v.xyz, (float3)(p.xyz - sphere.xyz));
+		}
+	}
+#endif
 
 	if (p.y < bounds->MinExtent.y)
 		return ResolveCollision(v.xyz, (float3)(0.0, 1.0, 0.0));
@@ -87,58 +207,354 @@ float Remap01(float low, float high, float t)
 }
 
 
-kernel void ParticleSimulation(global float4* positionBuffer, global float4* velocityBuffer, global float4* colorBuffer, global simulation_bounds* bounds, global float4* spheresBuffer, global float* time)
+// Upward kick of one pulse, strongest near the bottom center, added to the y velocity.  id is
+// the particle's global index.
+float PulseImpulse(float4 p, global simulation_bounds* bounds, uint seed, uint id, uint pulse)
 {
-	constant float4 G = (float4) (0., -9.8 * 4, 0., 0.);
-	constant float  DT = 0.00125;
-	int gid = get_global_id(0);
+	float size = (float)abs((long)(bounds->MaxExtent.x - bounds->MinExtent.x));
+	float3 bottomCenter = (float3)(0.0f, bounds->MinExtent.y, 0.0f);
 
-	float4 p = positionBuffer[gid];
-	float4 v = velocityBuffer[gid];
-	float4 c = colorBuffer[gid];
+	float maxForce = 50.0f;
+	float yEffect = (bounds->MaxExtent.y - p.y) / size;
+	float forcePercent = (size - sqrt(LengthSquared(p.xyz - bottomCenter))) / size;
 
-	float4 pp = p + v * DT + G * (float4)(0.5 * DT * DT);
-	pp.w = 1.0;
-	float4 vp = UpdateVelocity(pp, v + G * DT, bounds, spheresBuffer);
-	vp.w = 0.0;
+	float r = Uniform4(seed, id, pulse, RNG_STREAM_PULSE).x;
+	return maxForce * forcePercent * forcePercent * yEffect * yEffect * r;
+}
 
-	pp = p + vp * DT + G * (float4)(0.5 * DT * DT);
 
-	long size = abs((long)(bounds->MaxExtent.x - bounds->MinExtent.x));
+// positionBuffer holds the simulation state.  The new position is also written to
+// renderPositionBuffer, the VBO being drawn next, which may alias positionBuffer when headless.
+// The particle kernels may run over a slice of the particles, launched with a global offset
+// and bound to sub-buffers that start at that offset: buffers are indexed relative to it,
+// random draws by the particle's global id.
+// Each work-item steps particlesPerItem particles, one global size apart so neighboring
+// work-items still touch neighboring particles.
+// Pulses firstPulse to firstPulse + pulseCount - 1, queued since the last step, are added to
+// the velocity first, in order, as the separate pulse pass used to.
+// renderPreviousBuffer receives the position the launch started from, which the vertex shader
+// interpolates from; it aliases positionBuffer when nothing interpolates.
+kernel void ParticleSimulation(global float4* positionBuffer, global float4* velocityBuffer, global float4* renderPositionBuffer, global float4* colorBuffer, global simulation_bounds* bounds, global float4* spheresBuffer, global collider_grid* colliderGrid, global uint2* colliderCells, global uint* colliderIndices, float time, uint particlesPerItem,
+	uint seed, uint firstPulse, uint pulseCount, global float4* renderPreviousBuffer)
+{
+	const float DT = SIM_DT;
+	const int stride = get_global_size(0);
+
+	for (int gid = get_global_id(0) - get_global_offset(0), end = gid + stride * particlesPerItem; gid < end; gid += stride)
+	{
+		float4 p = positionBuffer[gid];
+		float4 v = velocityBuffer[gid];
+
+		for (uint pulse = firstPulse; pulse < firstPulse + pulseCount; pulse++)
+			v.y += PulseImpulse(p, bounds, seed, gid + get_global_offset(0), pulse);
+
+		// The particle stays in registers across the substeps.  Color follows the position at
+		// the start of the last one; the previous render position is the one at the first.
+		float4 previous = p;
+		float4 start = p;
+		for (int substep = 0; substep < SIM_SUBSTEPS; substep++)
+		{
+			start = p;
+			// Gravity only touches y, so x and z never pick up a 0.0f the host doesn't add.
+			float4 pp = v * DT + p;
+			pp.y += HALF_G_DT2;
+			pp.w = 1.0f;
+			float4 vg = v;
+			vg.y += G_DT;
+			float4 vp = UpdateVelocity(pp, vg, bounds, spheresBuffer, colliderGrid, colliderCells, colliderIndices);
+			vp.w = 0.0f;
+
+			p = vp * DT + p;
+			p.y += HALF_G_DT2;
+			v = vp;
+		}
+
+		positionBuffer[gid] = p;
+		if (renderPositionBuffer != positionBuffer)
+			renderPositionBuffer[gid] = p;
+		if (renderPreviousBuffer != positionBuffer)
+			renderPreviousBuffer[gid] = previous;
+		velocityBuffer[gid] = v;
+
+#if !SIM_SHADER_COLOR
+		float heightPercent = Remap01(bounds->MinExtent.y, bounds->MaxExtent.y, start.y);
+
+		float3 xyzPercent = (float3)(
+			Remap01(bounds->MinExtent.x, bounds->MaxExtent.x, start.x), 
+			Remap01(bounds->MinExtent.y, bounds->MaxExtent.y, start.y), 
+			Remap01(bounds->MinExtent.z, bounds->MaxExtent.z, start.z)
+		);
+
+		float3 randomOverTime = (float3)(0.5f, 0.5f, 0.5f) + (float3)(0.5f, 0.5f, 0.5f) * cos((float3)(time, time, time) + xyzPercent + (float3)(0, 2, 4));
+		float3 color = mix(randomOverTime, (float3)(0.0, 1.0, 0.0), heightPercent);
+		colorBuffer[gid] = (float4)(color.x, color.y, color.z, 1.0f);
+#endif
+	}
+}
 
-	float heightPercent = Remap01(bounds->MinExtent.y, bounds->MaxExtent.y, p.y);
+kernel void InitializeParticles(global float4* positionBuffer, global float4* velocityBuffer, global float4* renderPositionBuffer, global float4* colorBuffer, global particle_spawn* spawn, global float4* renderPreviousBuffer)
+{
+	uint id = get_global_id(0);
+	uint gid = id - get_global_offset(0);
+	float4 w = Uniform4(spawn->Seed, id, 0, RNG_STREAM_SPAWN_VELOCITY);
+
+	// Uniform in the sphere: the first of the particle's points in the enclosing cube to land
+	// inside it.  No transcendentals, so the host spawns the same bits.
+	float3 offset = (float3)(0.0f, 0.0f, 0.0f);
+	for (uint attempt = 0; attempt < SPAWN_MAX_TRIES; attempt++)
+	{
+		float4 u = Uniform4(spawn->Seed, id, attempt, RNG_STREAM_SPAWN);
+		float3 candidate = (float3)(2.0f * u.x - 1.0f, 2.0f * u.y - 1.0f, 2.0f * u.z - 1.0f);
+		if (LengthSquared(candidate) < 1.0f)
+		{
+			offset = candidate;
+			break;
+		}
+	}
+
+	float4 position = (float4)(spawn->Center.xyz + offset * spawn->Radius, 1.0f);
+	positionBuffer[gid] = position;
+	if (renderPositionBuffer != positionBuffer)
+		renderPositionBuffer[gid] = position;
+	if (renderPreviousBuffer != positionBuffer)
+		renderPreviousBuffer[gid] = position;
+
+	float4 low = spawn->MinVelocity;
+	float4 high = spawn->MaxVelocity;
+	velocityBuffer[gid] = (float4)(UniformRange(w.x, low.x, high.x), UniformRange(w.y, low.y, high.y), UniformRange(w.z, low.z, high.z), 0.0f);
+#if !SIM_SHADER_COLOR
+	colorBuffer[gid] = (float4)(1.0f, 1.0f, 1.0f, 1.0f);
+#endif
+}
 
-	float3 xyzPercent = (float3)(
-		Remap01(bounds->MinExtent.x, bounds->MaxExtent.x, p.x), 
-		Remap01(bounds->MinExtent.y, bounds->MaxExtent.y, p.y), 
-		Remap01(bounds->MinExtent.z, bounds->MaxExtent.z, p.z)
-	);
 
-	float3 randomOverTime = (float3)(0.5f, 0.5f, 0.5f) + (float3)(0.5f, 0.5f, 0.5f) * cos((float3)(*time, *time, *time) + xyzPercent + (float3)(0, 2, 4));
-	float3 color = mix(randomOverTime, (float3)(0.0, 1.0, 0.0), heightPercent);
-	
-	positionBuffer[gid] = pp;
-	velocityBuffer[gid] = vp;
-	colorBuffer[gid] = (float4)(color.x, color.y, color.z, 1.0f);
+
+// ---- Neighbor search ------------------------------------------------------------------
+// Particles are hashed to cells of the interaction radius, radix sorted by cell key, and
+// each key's [start, end) range in the sorted order is recorded.  Kernels then walk the
+// 27 surrounding cells with FOR_EACH_NEIGHBOR.
+
+typedef struct hash_grid
+{
+	float4 Origin;
+	float InvCellSize;
+	uint TableMask;
+	uint Padding[2];
+} hash_grid;
+
+int3 HashGridCell(float4 p, global hash_grid* grid)
+{
+	return convert_int3_rtn((p.xyz - grid->Origin.xyz) * grid->InvCellSize);
 }
 
-kernel void ApplyPulse(global float4* positionBuffer, global float4* velocityBuffer, global simulation_bounds* bounds)
+uint HashGridKey(int3 cell, global hash_grid* grid)
 {
-	constant float4 G = (float4) (0., -9.8 * 4, 0., 0.);
-	constant float  DT = 0.00125;
-	int gid = get_global_id(0);
+	return (((uint)cell.x * 73856093u) ^ ((uint)cell.y * 19349663u) ^ ((uint)cell.z * 83492791u)) & grid->TableMask;
+}
 
-	long size = abs((long)(bounds->MaxExtent.x - bounds->MinExtent.x));
-	float3 bottomCenter = (float3)(0.0f, bounds->MinExtent.y, 0.0f);
+int3 NextNeighborOffset(int3 offset)
+{
+	offset.x++;
+	if (offset.x > 1) { offset.x = -1; offset.y++; }
+	if (offset.y > 1) { offset.y = -1; offset.z++; }
+	return offset;
+}
+
+// True when an offset walked before 'offset' hashes to 'key' as well, so its bucket was already visited.
+bool IsNeighborKeyWalked(int3 base, int3 offset, uint key, global hash_grid* grid)
+{
+	for (int3 earlier = (int3)(-1, -1, -1); any(earlier != offset); earlier = NextNeighborOffset(earlier))
+		if (HashGridKey(base + earlier, grid) == key)
+			return true;
+	return false;
+}
+
+// Binds 'neighbor' to the index of every particle in the 27 cells around 'position', the
+// particle itself included.  Hash collisions can pull in particles from distant cells, so the
+// body must still test distance.  Two of the cells can also share a bucket, which is walked
+// only the first time, so no particle is bound twice.  'break' only leaves the current cell.
+#define FOR_EACH_NEIGHBOR(position, hashGrid, cellStart, cellEnd, sortedIndices, neighbor) \
+	for (int3 _base = HashGridCell(position, hashGrid), _offset = (int3)(-1, -1, -1); _offset.z <= 1; _offset = NextNeighborOffset(_offset)) \
+		for (uint _cell = HashGridKey(_base + _offset, hashGrid), _walked = IsNeighborKeyWalked(_base, _offset, _cell, hashGrid), \
+			_entry = _walked ? 0 : cellStart[_cell], _end = _walked ? 0 : cellEnd[_cell]; _entry < _end; _entry++) \
+			for (uint neighbor = sortedIndices[_entry], _once = 1; _once; _once = 0)
+
+kernel void ComputeCellKeys(global float4* positionBuffer, global hash_grid* hashGrid, global uint* cellKeys, global uint* particleIndices, uint count)
+{
+	uint gid = get_global_id(0);
+	if (gid >= count)
+		return;
 
-	float4 p = positionBuffer[gid];
+	cellKeys[gid] = HashGridKey(HashGridCell(positionBuffer[gid], hashGrid), hashGrid);
+	particleIndices[gid] = gid;
+}
 
-	float maxForce = 50.0f;
-	float yEffect = pow((bounds->MaxExtent.y - p.y) / (float)size, 2.0f);
-	float forcePercent = pow(((float)(size) - length(p.xyz - bottomCenter)) / (float)(size), 2.0f);
+kernel void ClearCellRanges(global uint* cellStart, global uint* cellEnd)
+{
+	uint gid = get_global_id(0);
+	cellStart[gid] = 0;
+	cellEnd[gid] = 0;
+}
+
+kernel void FindCellRanges(global uint* sortedKeys, global uint* cellStart, global uint* cellEnd, uint count)
+{
+	uint gid = get_global_id(0);
+	if (gid >= count)
+		return;
+
+	uint key = sortedKeys[gid];
+	if (gid == 0 || sortedKeys[gid - 1] != key)
+		cellStart[key] = gid;
+	if (gid == count - 1 || sortedKeys[gid + 1] != key)
+		cellEnd[key] = gid + 1;
+}
+
+
+
+// ---- Radix sort -----------------------------------------------------------------------
+// Stable LSD sort of (key, value) uint pairs, RADIX_BITS per pass: count, scan, scatter.
+
+#define RADIX_BITS 4
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_GROUP_SIZE 256
+#define RADIX_ITEMS_PER_THREAD 16
+#define RADIX_BLOCK_SIZE (RADIX_GROUP_SIZE * RADIX_ITEMS_PER_THREAD)
+
+// Each work-item owns a contiguous segment of the group's block, which keeps the sort stable.
+// Leaves counts[digit * RADIX_GROUP_SIZE + lid] holding the work-item's per-digit counts.
+void RadixCountSegment(global uint* keys, uint count, uint shift, local uint* counts)
+{
+	uint lid = get_local_id(0);
+	for (uint digit = 0; digit < RADIX_BUCKETS; digit++)
+		counts[digit * RADIX_GROUP_SIZE + lid] = 0;
+
+	uint begin = get_group_id(0) * RADIX_BLOCK_SIZE + lid * RADIX_ITEMS_PER_THREAD;
+	uint end = min(begin + RADIX_ITEMS_PER_THREAD, count);
+	for (uint i = begin; i < end; i++)
+		counts[((keys[i] >> shift) & (RADIX_BUCKETS - 1)) * RADIX_GROUP_SIZE + lid]++;
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+// histogram is digit-major, so its exclusive scan is every (digit, group)'s first output slot.
+kernel void RadixCount(global uint* keys, global uint* histogram, uint count, uint shift)
+{
+	local uint counts[RADIX_BUCKETS * RADIX_GROUP_SIZE];
+	RadixCountSegment(keys, count, shift, counts);
+
+	uint lid = get_local_id(0);
+	if (lid < RADIX_BUCKETS)
+	{
+		uint total = 0;
+		for (uint t = 0; t < RADIX_GROUP_SIZE; t++)
+			total += counts[lid * RADIX_GROUP_SIZE + t];
+		histogram[lid * get_num_groups(0) + get_group_id(0)] = total;
+	}
+}
+
+// Exclusive scan in place.  Launched as a single work-group of RADIX_GROUP_SIZE.
+kernel void RadixScan(global uint* histogram, uint length)
+{
+	local uint sums[RADIX_GROUP_SIZE];
+	uint lid = get_local_id(0);
+
+	uint chunk = (length + RADIX_GROUP_SIZE - 1) / RADIX_GROUP_SIZE;
+	uint begin = min(lid * chunk, length);
+	uint end = min(begin + chunk, length);
+
+	uint sum = 0;
+	for (uint i = begin; i < end; i++)
+		sum += histogram[i];
+	sums[lid] = sum;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	if (lid == 0)
+	{
+		uint running = 0;
+		for (uint t = 0; t < RADIX_GROUP_SIZE; t++)
+		{
+			uint value = sums[t];
+			sums[t] = running;
+			running += value;
+		}
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	uint running = sums[lid];
+	for (uint i = begin; i < end; i++)
+	{
+		uint value = histogram[i];
+		histogram[i] = running;
+		running += value;
+	}
+}
 
-	float r = random(p.xyz);
-	float4 vel = (float4)(0.0f, 1.0f, 0.0f, 0.0f) * maxForce * forcePercent * yEffect * r;
-	velocityBuffer[gid] += vel;
+kernel void RadixScatter(global uint* keys, global uint* values, global uint* sortedKeys, global uint* sortedValues, global uint* histogram, uint count, uint shift)
+{
+	local uint counts[RADIX_BUCKETS * RADIX_GROUP_SIZE];
+	RadixCountSegment(keys, count, shift, counts);
+
+	// Turn each digit's row into the output slot of every work-item's first element of that digit.
+	uint lid = get_local_id(0);
+	if (lid < RADIX_BUCKETS)
+	{
+		uint running = histogram[lid * get_num_groups(0) + get_group_id(0)];
+		for (uint t = 0; t < RADIX_GROUP_SIZE; t++)
+		{
+			uint value = counts[lid * RADIX_GROUP_SIZE + t];
+			counts[lid * RADIX_GROUP_SIZE + t] = running;
+			running += value;
+		}
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	uint begin = get_group_id(0) * RADIX_BLOCK_SIZE + lid * RADIX_ITEMS_PER_THREAD;
+	uint end = min(begin + RADIX_ITEMS_PER_THREAD, count);
+	for (uint i = begin; i < end; i++)
+	{
+		uint key = keys[i];
+		uint slot = counts[((key >> shift) & (RADIX_BUCKETS - 1)) * RADIX_GROUP_SIZE + lid]++;
+		sortedKeys[slot] = key;
+		sortedValues[slot] = values[i];
+	}
 }
 
+
+
+// ---- Morton reorder -------------------------------------------------------------------
+// Particles are periodically sorted along a Z-order curve so that neighbors in space are
+// also neighbors in memory.
+
+// Spreads the low 10 bits of v so there are two zero bits between each.
+uint MortonSpread(uint v)
+{
+	v &= 0x3ffu;
+	v = (v | (v << 16)) & 0x030000ffu;
+	v = (v | (v << 8)) & 0x0300f00fu;
+	v = (v | (v << 4)) & 0x030c30c3u;
+	v = (v | (v << 2)) & 0x09249249u;
+	return v;
+}
+
+kernel void ComputeMortonKeys(global float4* positionBuffer, global simulation_bounds* bounds, global uint* mortonKeys, global uint* particleIndices, uint count)
+{
+	uint gid = get_global_id(0);
+	if (gid >= count)
+		return;
+
+	float3 extent = bounds->MaxExtent.xyz - bounds->MinExtent.xyz;
+	float3 normalized = clamp((positionBuffer[gid].xyz - bounds->MinExtent.xyz) / extent, 0.0f, 1.0f);
+	uint3 cell = convert_uint3_rtz(normalized * 1023.0f);
+
+	mortonKeys[gid] = MortonSpread(cell.x) | (MortonSpread(cell.y) << 1) | (MortonSpread(cell.z) << 2);
+	particleIndices[gid] = gid;
+}
+
+kernel void GatherFloat4(global float4* source, global float4* destination, global uint* indices, uint count)
+{
+	uint gid = get_global_id(0);
+	if (gid >= count)
+		return;
+
+	destination[gid] = source[indices[gid]];
+}
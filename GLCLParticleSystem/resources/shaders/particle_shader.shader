@@ -3,14 +3,32 @@
 
 layout(location = 0) in vec4 a_Position;
 layout(location = 1) in vec4 a_Color;
+// Where the step that produced a_Position started.  Left unbound, and u_Alpha 1, when the
+// system doesn't interpolate.
+layout(location = 2) in vec4 a_PreviousPosition;
 
 uniform mat4 u_ViewProjectionMatrix;
+uniform float u_Alpha;
+// Set when the kernels leave the color to this shader; a_Color is then unbound.
+uniform bool u_ShaderColor;
+uniform vec3 u_BoundsMin;
+uniform vec3 u_BoundsMax;
+uniform float u_Time;
 out vec4 v_Color;
 
 void main()
 {
-	v_Color = a_Color;
-	gl_Position = u_ViewProjectionMatrix * a_Position;
+	vec4 position = mix(a_PreviousPosition, a_Position, u_Alpha);
+	if (u_ShaderColor)
+	{
+		// As ParticleSimulation colors: cycling over time by place, turning green with height.
+		vec3 xyzPercent = (position.xyz - u_BoundsMin) / (u_BoundsMax - u_BoundsMin);
+		vec3 randomOverTime = vec3(0.5) + vec3(0.5) * cos(vec3(u_Time) + xyzPercent + vec3(0.0, 2.0, 4.0));
+		v_Color = vec4(mix(randomOverTime, vec3(0.0, 1.0, 0.0), xyzPercent.y), 1.0);
+	}
+	else
+		v_Color = a_Color;
+	gl_Position = u_ViewProjectionMatrix * position;
 }
 
 #type fragment
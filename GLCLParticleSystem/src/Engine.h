@@ -4,14 +4,20 @@
 #include "Engine/Time.h"
 #include "Engine/Window.h"
 #include "Engine/Random.h"
+#include "Engine/Philox.h"
 #include "Engine/Input.h"
 #include "Engine/MouseCodes.h"
 #include "Engine/KeyCodes.h"
+#include "Engine/Threading/JobSystem.h"
 
 #include "Engine/Compute/OpenCLBuffer.h"
 #include "Engine/Compute/OpenCLContext.h"
 #include "Engine/Compute/OpenCLKernel.h"
 #include "Engine/Compute/OpenCLProgram.h"
+#include "Engine/Compute/OpenCLGraph.h"
+#include "Engine/Compute/OpenCLProfiler.h"
+#include "Engine/Compute/OpenCLAutotuner.h"
+#include "Engine/Compute/OpenCLReadback.h"
 
 #include "Engine/Renderer/BufferLayout.h"
 #include "Engine/Renderer/Camera.h"
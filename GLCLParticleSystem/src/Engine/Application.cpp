@@ -7,6 +7,7 @@
 #include "Engine/Renderer/RenderCommand.h"
 #include "Engine/Random.h"
 #include "Engine/Input.h"
+#include "Engine/Threading/JobSystem.h"
 
 #include <GLFW/glfw3.h>
 
@@ -14,11 +15,11 @@ namespace Engine
 {
 	Application* Application::s_Instance = nullptr;
 
-	void Application::Create(const std::string& name)
+	void Application::Create(const std::string& name, bool headless)
 	{
 		if (s_Instance != nullptr) return;
 
-		s_Instance = new Application(name);
+		s_Instance = new Application(name, headless);
 	}
 
 	void Application::Shutdown()
@@ -27,19 +28,45 @@ namespace Engine
 		delete s_Instance;
 	}
 
-	Application::Application(const std::string& name)
-		:m_Name(name)
+	Application::Application(const std::string& name, bool headless)
+		:m_Name(name), m_Headless(headless)
 	{
+		if (m_Headless)
+		{
+			Log::Initialize();
+			Random::Initialize();
+			JobSystem::Initialize();
+
+			ParticleSystemProperties properties;
+			properties.Backend = SimulationBackend::CPU;
+			m_PS = new Engine::ParticleSystem(properties, "resources/cl/particle_sim.cl", "resources/shaders/particle_shader.shader");
+			m_PS->Start();
+			return;
+		}
+
 		Window::Create(name, 1920, 1080);
 		Window::SetEventCallbackFunction(BIND_FN(OnEvent));
 		Log::Initialize();
 		Random::Initialize();
+		JobSystem::Initialize();
 		RenderCommand::Initialize();
 		RenderCommand::SetViewport(Window::GetWidth(), Window::GetHeight());
-		OpenCLContext::Initialize();
-		OpenCLContext::ToggleDebug(false);
 
 		ParticleSystemProperties properties;
+		if (!OpenCLContext::Initialize())
+		{
+			LOG_WARN("OpenCL/GL interop unavailable -- falling back to the CPU backend.  Particles will not be rendered.");
+			properties.Backend = SimulationBackend::CPU;
+		}
+		OpenCLContext::ToggleDebug(false);
+
+		// Simulated time follows the clock down to 1 / MaxTickTime frames per second.  Real time
+		// takes 1 / TimeStep steps per second, so each launch runs several to keep it to a few
+		// launches per frame.
+		properties.FixedTimestep = true;
+		properties.Substeps = 4;
+		properties.ShaderColor = true;
+
 		m_PS = new Engine::ParticleSystem(properties, "resources/cl/particle_sim.cl", "resources/shaders/particle_shader.shader");
 
 		m_Camera.SetPerspective();
@@ -49,7 +76,10 @@ namespace Engine
 	Application::~Application()
 	{
 		delete m_PS;
-		Window::Shutdown();
+		JobSystem::Shutdown();
+
+		if (!m_Headless)
+			Window::Shutdown();
 	}
 
 	void Application::Run()
@@ -60,6 +90,13 @@ namespace Engine
 				break;
 
 			Time::Tick();
+
+			if (s_Instance->m_Headless)
+			{
+				s_Instance->m_PS->Tick(Time::DeltaTime());
+				continue;
+			}
+
 			s_Instance->m_Camera.Update(Time::DeltaTime());
 			RenderCommand::Clear(true, true);
 			RenderCommand::ClearColor({ 0.1f, 0.1f, 0.1f, 0.1f });
@@ -72,6 +109,9 @@ namespace Engine
 
 		float performance = s_Instance->m_PS->GetProperties().ParticleCount / (s_Instance->m_PS->GetAverageFrameTime());
 		LOG_INFO("{}, {}, {}", s_Instance->m_PS->GetProperties().ParticleCount, (float)s_Instance->m_PS->GetAverageFrameTime(), performance / 1000.0f);
+
+		if (OpenCLProfiler* profiler = s_Instance->m_PS->GetProfiler())
+			profiler->LogReport();
 	}
 
 	void Application::OnEvent(Event& event)
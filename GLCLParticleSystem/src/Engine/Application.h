@@ -17,11 +17,11 @@ namespace Engine
 		static Application& GetApplication() { return *s_Instance; }
 		const std::string& GetName() const { return m_Name; }
 
-		static void Create(const std::string& name = "Application");
+		static void Create(const std::string& name = "Application", bool headless = false);
 		static void Shutdown();
 
 	private:
-		Application(const std::string& name);
+		Application(const std::string& name, bool headless);
 		~Application();
 		
 	private:
@@ -36,6 +36,7 @@ namespace Engine
 		Camera m_Camera;
 		ParticleSystem* m_PS;
 		bool m_IsRunning = true;
+		bool m_Headless = false;
 		std::string m_Name;
 	};
 }
\ No newline at end of file
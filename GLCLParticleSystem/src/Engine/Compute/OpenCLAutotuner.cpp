@@ -0,0 +1,174 @@
+#include "glclpch.h"
+#include "Engine/Compute/OpenCLAutotuner.h"
+#include "Engine/Compute/OpenCLContext.h"
+#include "Engine/Compute/OpenCLProgram.h"
+#include "Engine/Compute/OpenCLBinaryCache.h"
+
+#include <filesystem>
+
+namespace Engine
+{
+	std::string OpenCLAutotuner::s_Path;
+	bool OpenCLAutotuner::s_PathSet = false;
+	bool OpenCLAutotuner::s_Loaded = false;
+	std::unordered_map<uint64_t, KernelTuning> OpenCLAutotuner::s_Results;
+
+	uint64_t OpenCLAutotuner::ComputeKey(const OpenCLProgram* program, const std::string& kernelName, size_t itemCount)
+	{
+		uint64_t count = itemCount;
+		uint64_t key = HashString(kernelName, program->GetCacheKey());
+		return HashBytes(&count, sizeof(count), key);
+	}
+
+	std::string OpenCLAutotuner::GetPath()
+	{
+		if (s_PathSet)
+			return s_Path;
+		if (!OpenCLBinaryCache::IsEnabled())
+			return std::string();
+		return (std::filesystem::path(OpenCLBinaryCache::GetDirectory()) / "autotune.txt").string();
+	}
+
+	void OpenCLAutotuner::Load()
+	{
+		s_Loaded = true;
+		s_Results.clear();
+		std::string resultsPath = GetPath();
+		if (resultsPath.empty())
+			return;
+
+		// One "<key> <local size> <items per work-item>" line per kernel; anything else is skipped.
+		std::ifstream in(resultsPath);
+		std::string line;
+		while (std::getline(in, line))
+		{
+			unsigned long long key;
+			KernelTuning tuning;
+			if (sscanf(line.c_str(), "%llx %u %u", &key, &tuning.LocalSize, &tuning.ItemsPerWorkItem) == 3 && tuning.IsValid() && tuning.ItemsPerWorkItem > 0)
+				s_Results[key] = tuning;
+		}
+	}
+
+	bool OpenCLAutotuner::Lookup(uint64_t key, KernelTuning& tuning)
+	{
+		if (!s_Loaded)
+			Load();
+
+		auto result = s_Results.find(key);
+		if (result == s_Results.end())
+			return false;
+
+		tuning = result->second;
+		return true;
+	}
+
+	void OpenCLAutotuner::Store(uint64_t key, const KernelTuning& tuning)
+	{
+		// Picks up entries other runs stored since this one loaded.
+		Load();
+		s_Results[key] = tuning;
+		std::string resultsPath = GetPath();
+		if (resultsPath.empty())
+			return;
+
+		std::error_code error;
+		std::filesystem::path path(resultsPath);
+		if (path.has_parent_path())
+			std::filesystem::create_directories(path.parent_path(), error);
+
+		// Written aside and renamed into place, like the binary cache, so readers never see half a file.
+		std::string temporaryPath = resultsPath + "." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+		{
+			std::ofstream out(temporaryPath);
+			for (const auto& entry : s_Results)
+			{
+				char line[64];
+				snprintf(line, sizeof(line), "%016llx %u %u\n", (unsigned long long)entry.first, entry.second.LocalSize, entry.second.ItemsPerWorkItem);
+				out << line;
+			}
+			if (!out)
+			{
+				LOG_WARN("Failed to write autotuning results {}.", temporaryPath);
+				out.close();
+				std::filesystem::remove(temporaryPath, error);
+				return;
+			}
+		}
+
+		std::filesystem::rename(temporaryPath, resultsPath, error);
+		if (error)
+		{
+			LOG_WARN("Failed to store autotuning results {}: {}.", resultsPath, error.message());
+			std::filesystem::remove(temporaryPath, error);
+		}
+	}
+
+	std::vector<uint32_t> OpenCLAutotuner::GetLocalSizeCandidates(cl_kernel kernel, size_t workItemCount)
+	{
+		size_t preferredMultiple = 0;
+		clGetKernelWorkGroupInfo(kernel, OpenCLContext::GetDevice(), CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE, sizeof(preferredMultiple), &preferredMultiple, NULL);
+
+		size_t limit = SIZE_MAX;
+		for (cl_device_id device : OpenCLContext::GetDevices())
+		{
+			size_t kernelMax = 0, deviceMax = 0;
+			clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(kernelMax), &kernelMax, NULL);
+			clGetDeviceInfo(device, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(deviceMax), &deviceMax, NULL);
+			limit = std::min(limit, std::min(kernelMax, deviceMax));
+		}
+		std::vector<uint32_t> candidates;
+		for (size_t size = std::max<size_t>(preferredMultiple, 1); size <= limit; size *= 2)
+		{
+			if (workItemCount % size == 0)
+				candidates.push_back((uint32_t)size);
+		}
+		return candidates;
+	}
+
+	KernelTuning OpenCLAutotuner::Tune(const std::string& label, const std::vector<KernelTuning>& candidates, const std::function<cl_event(const KernelTuning&)>& launch, uint32_t repetitions)
+	{
+		KernelTuning best;
+		double bestSeconds = 0.0;
+
+		for (const KernelTuning& candidate : candidates)
+		{
+			// The first run pays for cold caches and lazy allocation, so it isn't timed.
+			cl_event event = launch(candidate);
+			OpenCLContext::WaitForEvent(event);
+
+			std::vector<double> seconds;
+			for (uint32_t i = 0; i < repetitions; i++)
+			{
+				event = launch(candidate);
+				if (event == nullptr)
+					break;
+				clWaitForEvents(1, &event);
+
+				cl_ulong start = 0, end = 0;
+				clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(start), &start, NULL);
+				clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL);
+				clReleaseEvent(event);
+				seconds.push_back((end - start) * 1e-9);
+			}
+			if (seconds.empty())
+				continue;
+
+			// The median shrugs off the odd preempted run.
+			std::sort(seconds.begin(), seconds.end());
+			double median = seconds[seconds.size() / 2];
+			LOG_TRACE("{}: local size {}, {} per work-item: {:.3f} ms", label, candidate.LocalSize, candidate.ItemsPerWorkItem, median * 1000.0);
+
+			if (!best.IsValid() || median < bestSeconds)
+			{
+				best = candidate;
+				bestSeconds = median;
+			}
+		}
+
+		if (best.IsValid())
+			LOG_INFO("Tuned {}: local size {}, {} per work-item ({:.3f} ms).", label, best.LocalSize, best.ItemsPerWorkItem, bestSeconds * 1000.0);
+		else
+			LOG_WARN("No launch shape could be timed for {}.", label);
+		return best;
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <OpenCL/cl.h>
+
+namespace Engine
+{
+	class OpenCLProgram;
+
+	// How one kernel is launched: work-items per group, and items each work-item processes.
+	struct KernelTuning
+	{
+		uint32_t LocalSize = 0;
+		uint32_t ItemsPerWorkItem = 1;
+
+		bool IsValid() const { return LocalSize > 0; }
+	};
+
+	// Picks launch shapes by timing candidates on the device, and remembers the winners in a file
+	// keyed by device, kernel source and problem size so later runs skip the search.
+	class OpenCLAutotuner
+	{
+	public:
+		// An empty path keeps results for this process only.  Unless set, results go to
+		// autotune.txt in OpenCLBinaryCache's directory, and stay in the process when that
+		// cache is disabled.
+		static void SetPath(const std::string& path) { s_Path = path; s_PathSet = true; s_Loaded = false; }
+		static std::string GetPath();
+
+		// Identifies kernelName of program run over itemCount items.  The program's cache key
+		// already covers its source, build options and devices.
+		static uint64_t ComputeKey(const OpenCLProgram* program, const std::string& kernelName, size_t itemCount);
+		static bool Lookup(uint64_t key, KernelTuning& tuning);
+		static void Store(uint64_t key, const KernelTuning& tuning);
+
+		// Local sizes worth timing for kernel: the first device's preferred work-group size multiple
+		// doubled up to the kernel's and the device's limits on every device of the context, since
+		// multi-device steps launch the winner everywhere, keeping those that divide workItemCount.
+		static std::vector<uint32_t> GetLocalSizeCandidates(cl_kernel kernel, size_t workItemCount);
+
+		// Times every candidate and returns the fastest, or an invalid tuning if none ran.  launch
+		// enqueues one run of a candidate and returns its retained completion event.
+		static KernelTuning Tune(const std::string& label, const std::vector<KernelTuning>& candidates, const std::function<cl_event(const KernelTuning&)>& launch, uint32_t repetitions = 5);
+
+	private:
+		static void Load();
+
+	private:
+		static std::string s_Path;
+		static bool s_PathSet;
+		static bool s_Loaded;
+		static std::unordered_map<uint64_t, KernelTuning> s_Results;
+	};
+}
@@ -0,0 +1,199 @@
+#include "glclpch.h"
+#include "Engine/Compute/OpenCLBinaryCache.h"
+#include "Engine/Compute/OpenCLContext.h"
+
+#include <filesystem>
+
+namespace Engine
+{
+	std::string OpenCLBinaryCache::s_Directory = ".clcache";
+
+	// Bumped whenever the entry layout changes, which turns every old entry into a miss.
+	static constexpr uint32_t c_EntryVersion = 2;
+
+	// Followed by a payload of DeviceCount binaries in the context's device order, each a
+	// uint64_t size and then its bytes.  PayloadHash covers the whole payload.
+	struct CacheEntryHeader
+	{
+		char Magic[4];
+		uint32_t Version;
+		uint64_t Key;
+		uint64_t DeviceCount;
+		uint64_t PayloadSize;
+		uint64_t PayloadHash;
+	};
+
+	uint64_t OpenCLBinaryCache::ComputeKey(const std::string& source, const std::string& options)
+	{
+		// The driver version matters as much as the device: a driver update can change the
+		// binary format or fix codegen, and either must force a rebuild.
+		uint64_t key = HashString(source);
+		key = HashString(options, key);
+		for (cl_device_id device : OpenCLContext::GetDevices())
+		{
+			key = HashString(OpenCLContext::GetDeviceInfoString(CL_DEVICE_NAME, device), key);
+			key = HashString(OpenCLContext::GetDeviceInfoString(CL_DEVICE_VERSION, device), key);
+			key = HashString(OpenCLContext::GetDeviceInfoString(CL_DRIVER_VERSION, device), key);
+		}
+		key = HashString(OpenCLContext::GetPlatformInfoString(CL_PLATFORM_NAME), key);
+		key = HashString(OpenCLContext::GetPlatformInfoString(CL_PLATFORM_VERSION), key);
+		return key;
+	}
+
+	std::string OpenCLBinaryCache::GetEntryPath(uint64_t key)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.clbin", (unsigned long long)key);
+		return (std::filesystem::path(s_Directory) / name).string();
+	}
+
+	void OpenCLBinaryCache::Evict(uint64_t key, const char* reason)
+	{
+		LOG_WARN("Discarding cached OpenCL binary {}: {}.  Building from source.", GetEntryPath(key), reason);
+
+		std::error_code error;
+		std::filesystem::remove(GetEntryPath(key), error);
+	}
+
+	cl_program OpenCLBinaryCache::Load(uint64_t key, const std::string& options)
+	{
+		if (!IsEnabled())
+			return nullptr;
+
+		std::ifstream in(GetEntryPath(key), std::ios::binary);
+		if (!in)
+			return nullptr;
+
+		const std::vector<cl_device_id>& devices = OpenCLContext::GetDevices();
+
+		CacheEntryHeader header;
+		if (!in.read((char*)&header, sizeof(header)) || memcmp(header.Magic, "GLCB", 4) != 0 || header.Version != c_EntryVersion || header.Key != key || header.DeviceCount != devices.size())
+		{
+			in.close();
+			Evict(key, "bad header");
+			return nullptr;
+		}
+
+		std::vector<uint8_t> payload((size_t)header.PayloadSize);
+		if (payload.empty() || !in.read((char*)payload.data(), payload.size()) || HashBytes(payload.data(), payload.size()) != header.PayloadHash)
+		{
+			in.close();
+			Evict(key, "truncated or corrupt");
+			return nullptr;
+		}
+		in.close();
+
+		std::vector<const unsigned char*> binaries;
+		std::vector<size_t> binarySizes;
+		for (size_t offset = 0; binaries.size() < devices.size();)
+		{
+			uint64_t size = 0;
+			if (offset + sizeof(size) <= payload.size())
+				memcpy(&size, payload.data() + offset, sizeof(size));
+			offset += sizeof(size);
+
+			if (size == 0 || offset + size > payload.size())
+			{
+				Evict(key, "truncated or corrupt");
+				return nullptr;
+			}
+
+			binaries.push_back(payload.data() + offset);
+			binarySizes.push_back((size_t)size);
+			offset += (size_t)size;
+		}
+
+		std::vector<cl_int> binaryStatus(devices.size(), CL_SUCCESS);
+		cl_int status;
+		cl_program program = clCreateProgramWithBinary(OpenCLContext::GetContext(), (cl_uint)devices.size(), devices.data(), binarySizes.data(), binaries.data(), binaryStatus.data(), &status);
+		bool rejected = std::any_of(binaryStatus.begin(), binaryStatus.end(), [](cl_int s) { return s != CL_SUCCESS; });
+		if (status != CL_SUCCESS || rejected)
+		{
+			if (program != nullptr)
+				clReleaseProgram(program);
+			Evict(key, "rejected by the driver");
+			return nullptr;
+		}
+
+		// Binaries still have to be built, which only links on most drivers.
+		status = clBuildProgram(program, (cl_uint)devices.size(), devices.data(), options.c_str(), NULL, NULL);
+		if (status != CL_SUCCESS)
+		{
+			clReleaseProgram(program);
+			Evict(key, "failed to build");
+			return nullptr;
+		}
+
+		LOG_INFO("Loaded cached OpenCL binary {} ({} bytes, {} devices).", GetEntryPath(key), payload.size(), devices.size());
+		return program;
+	}
+
+	void OpenCLBinaryCache::Store(uint64_t key, cl_program program)
+	{
+		if (!IsEnabled())
+			return;
+
+		// The program is built for every device in the context, in the same order.
+		size_t deviceCount = OpenCLContext::GetDevices().size();
+		std::vector<size_t> binarySizes(deviceCount, 0);
+		cl_int status = clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t) * deviceCount, binarySizes.data(), NULL);
+		if (status != CL_SUCCESS || std::find(binarySizes.begin(), binarySizes.end(), 0) != binarySizes.end())
+		{
+			LOG_WARN("Device returned no program binary to cache.");
+			return;
+		}
+
+		std::vector<std::vector<uint8_t>> binaries(deviceCount);
+		std::vector<unsigned char*> binaryData(deviceCount);
+		for (size_t i = 0; i < deviceCount; i++)
+		{
+			binaries[i].resize(binarySizes[i]);
+			binaryData[i] = binaries[i].data();
+		}
+
+		status = clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(unsigned char*) * deviceCount, binaryData.data(), NULL);
+		OpenCLContext::PrintCLError(status, "clGetProgramInfo(CL_PROGRAM_BINARIES) failed");
+		if (status != CL_SUCCESS)
+			return;
+
+		std::vector<uint8_t> payload;
+		for (const std::vector<uint8_t>& binary : binaries)
+		{
+			uint64_t size = binary.size();
+			payload.insert(payload.end(), (const uint8_t*)&size, (const uint8_t*)&size + sizeof(size));
+			payload.insert(payload.end(), binary.begin(), binary.end());
+		}
+
+		CacheEntryHeader header = { { 'G', 'L', 'C', 'B' }, c_EntryVersion, key, deviceCount, payload.size(), HashBytes(payload.data(), payload.size()) };
+
+		std::error_code error;
+		std::filesystem::create_directories(s_Directory, error);
+
+		// Concurrent jobs may store the same entry, so each writes its own file and renames it
+		// into place; readers never see a partial entry.
+		std::string path = GetEntryPath(key);
+		std::string temporaryPath = path + "." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+		{
+			std::ofstream out(temporaryPath, std::ios::binary);
+			out.write((const char*)&header, sizeof(header));
+			out.write((const char*)payload.data(), payload.size());
+			if (!out)
+			{
+				LOG_WARN("Failed to write OpenCL binary cache entry {}.", temporaryPath);
+				out.close();
+				std::filesystem::remove(temporaryPath, error);
+				return;
+			}
+		}
+
+		std::filesystem::rename(temporaryPath, path, error);
+		if (error)
+		{
+			LOG_WARN("Failed to store OpenCL binary cache entry {}: {}.", path, error.message());
+			std::filesystem::remove(temporaryPath, error);
+			return;
+		}
+
+		LOG_INFO("Cached OpenCL binary {} ({} bytes, {} devices).", path, payload.size(), deviceCount);
+	}
+}
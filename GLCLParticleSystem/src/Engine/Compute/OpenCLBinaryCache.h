@@ -0,0 +1,35 @@
+#pragma once
+
+#include <OpenCL/cl.h>
+
+namespace Engine
+{
+	// On-disk cache of built program binaries, so repeated launches skip clBuildProgram from source.
+	// Entries are keyed by the source, the build options and the device, driver and platform
+	// versions, and carry a checksum of the binary.  Anything that doesn't load cleanly is
+	// discarded and the caller builds from source as before.
+	class OpenCLBinaryCache
+	{
+	public:
+		// An empty directory disables the cache.
+		static void SetDirectory(const std::string& directory) { s_Directory = directory; }
+		static const std::string& GetDirectory() { return s_Directory; }
+		static bool IsEnabled() { return !s_Directory.empty(); }
+
+		// Identifies a build of source with options for every device in the context.
+		static uint64_t ComputeKey(const std::string& source, const std::string& options);
+
+		// Creates and builds the cached program for key.  Returns null on a miss, or after
+		// evicting an entry that is stale or corrupt.
+		static cl_program Load(uint64_t key, const std::string& options);
+		// Writes the binaries of a program built for every device in the context.
+		static void Store(uint64_t key, cl_program program);
+
+	private:
+		static std::string GetEntryPath(uint64_t key);
+		static void Evict(uint64_t key, const char* reason);
+
+	private:
+		static std::string s_Directory;
+	};
+}
@@ -23,12 +23,24 @@ namespace Engine
 	}
 
 	OpenCLBuffer::OpenCLBuffer(OpenCLProgram* program, const std::string& bufferName, size_t dataSize, CLBufferType bufferType)
-		:m_Program(program), m_BufferName(bufferName), m_DataSize(dataSize), m_Type(bufferType)
+		:OpenCLBuffer(program, bufferName, dataSize, bufferType, OpenCLContext::IsHostUnifiedMemory() ? CL_MEM_ALLOC_HOST_PTR : 0, nullptr)
+	{
+	}
+
+	OpenCLBuffer::OpenCLBuffer(OpenCLProgram* program, const std::string& bufferName, size_t dataSize, CLBufferType bufferType, cl_mem_flags memoryFlags, void* hostMemory)
+		:m_Program(program), m_BufferName(bufferName), m_DataSize(dataSize), m_Type(bufferType), m_HostMemory(hostMemory)
 	{
 		cl_int status;
-		cl_mem_flags type = CLFlagsFromBufferType(bufferType);
-		m_BufferID = clCreateBuffer(OpenCLContext::GetContext(), type, dataSize, NULL, &status);
+		cl_mem_flags type = CLFlagsFromBufferType(bufferType) | memoryFlags;
+		m_BufferID = clCreateBuffer(OpenCLContext::GetContext(), type, dataSize, hostMemory, &status);
 		OpenCLContext::PrintCLError(status, "clCreateBuffer failed (1)");
+
+		m_HostVisible = (memoryFlags & (CL_MEM_ALLOC_HOST_PTR | CL_MEM_USE_HOST_PTR)) != 0;
+	}
+
+	OpenCLBuffer* OpenCLBuffer::FromHostMemory(OpenCLProgram* program, const std::string& bufferName, size_t dataSize, CLBufferType type, void* hostMemory)
+	{
+		return new OpenCLBuffer(program, bufferName, dataSize, type, CL_MEM_USE_HOST_PTR, hostMemory);
 	}
 
 	OpenCLBuffer::OpenCLBuffer(OpenCLProgram* program, const std::string& bufferName, size_t dataSize, CLBufferType bufferType, VertexBuffer* vbo)
@@ -40,8 +52,27 @@ namespace Engine
 		OpenCLContext::PrintCLError(status, "clCreateFromGLBuffer failed (1)");
 	}
 
+	OpenCLBuffer::OpenCLBuffer(OpenCLProgram* program, const std::string& bufferName, OpenCLBuffer* parent, size_t origin, size_t dataSize)
+		:m_Program(program), m_BufferName(bufferName), m_DataSize(dataSize), m_Type(parent->GetType()), m_HostVisible(parent->IsHostVisible())
+	{
+		if (parent->GetHostMemory() != nullptr)
+			m_HostMemory = (uint8_t*)parent->GetHostMemory() + origin;
+
+		cl_int status;
+		cl_buffer_region region = { origin, dataSize };
+		m_BufferID = clCreateSubBuffer(parent->GetBufferID(), CLFlagsFromBufferType(m_Type), CL_BUFFER_CREATE_TYPE_REGION, &region, &status);
+		OpenCLContext::PrintCLError(status, "clCreateSubBuffer failed");
+	}
+
 	OpenCLBuffer::~OpenCLBuffer()
 	{
 		clReleaseMemObject(m_BufferID);
 	}
+
+	CLCommandStats* OpenCLBuffer::GetProfileStats()
+	{
+		if (m_ProfileStats == nullptr)
+			m_ProfileStats = m_Program->GetProfiler().GetEntry(m_BufferName);
+		return m_ProfileStats;
+	}
 }
\ No newline at end of file
@@ -7,31 +7,63 @@
 namespace Engine
 {
 	class OpenCLProgram;
+	struct CLCommandStats;
 
 	enum class CLBufferType { None, WriteOnly, ReadOnly, ReadWrite };
 
 	class OpenCLBuffer
 	{
 	public:
+		// When the devices share memory with the host the buffer is allocated host-mappable
+		// (CL_MEM_ALLOC_HOST_PTR), and the program's uploads and readbacks map it instead of copying.
 		OpenCLBuffer(OpenCLProgram* program, const std::string& bufferName, size_t dataSize, CLBufferType type);
 		OpenCLBuffer(OpenCLProgram* program, const std::string& bufferName, size_t dataSize, CLBufferType type, VertexBuffer* vbo);
+		// A view of [origin, origin + dataSize) bytes of parent.  origin must be a multiple of the
+		// device's CL_DEVICE_MEM_BASE_ADDR_ALIGN.
+		OpenCLBuffer(OpenCLProgram* program, const std::string& bufferName, OpenCLBuffer* parent, size_t origin, size_t dataSize);
 		~OpenCLBuffer();
 
+		// Wraps dataSize bytes of caller memory (CL_MEM_USE_HOST_PTR), which must outlive the buffer.
+		// On host-unified devices the kernels then work on that memory directly, and uploads from
+		// or readbacks to it are just a map and unmap, the upload one without blocking.  Elsewhere the driver keeps a device copy.
+		static OpenCLBuffer* FromHostMemory(OpenCLProgram* program, const std::string& bufferName, size_t dataSize, CLBufferType type, void* hostMemory);
+
 		static size_t NativeSize() { return sizeof(cl_mem); }
 
 		bool IsAttachedToGLBuffer() const { return m_AttachedVBO != nullptr; }
+		// Whether CL currently holds the GL buffer, i.e. it is acquired and not yet released.
+		bool IsAcquired() const { return m_AcquireCount > 0; }
+		// Host-visible buffers are read back with a map rather than a copy.
+		bool IsHostVisible() const { return m_HostVisible; }
+		// The caller memory a FromHostMemory() buffer wraps, otherwise null.
+		void* GetHostMemory() const { return m_HostMemory; }
 
 		size_t GetBufferSize() const { return m_DataSize; }
 		const std::string& GetBufferName() const { return m_BufferName; }
 		cl_mem GetBufferID() const { return m_BufferID; }
 		CLBufferType GetType() const { return m_Type; }
+		// The program profiler's entry for this buffer's commands, resolved on first use.
+		CLCommandStats* GetProfileStats();
+
+	private:
+		OpenCLBuffer(OpenCLProgram* program, const std::string& bufferName, size_t dataSize, CLBufferType type, cl_mem_flags memoryFlags, void* hostMemory);
 
 	private:
 		VertexBuffer* m_AttachedVBO = nullptr;
+		// Outstanding acquires, counted by the program; only the first and last reach the driver.
+		uint32_t m_AcquireCount = 0;
+		CLCommandStats* m_ProfileStats = nullptr;
+		bool m_HostVisible = false;
+		void* m_HostMemory = nullptr;
+		// How the outstanding map, if any, was made; the unmap is profiled to match.
+		cl_map_flags m_MapFlags = 0;
+		size_t m_MappedBytes = 0;
 		CLBufferType m_Type;
 		OpenCLProgram* m_Program;
 		std::string m_BufferName;
 		size_t m_DataSize;
 		cl_mem m_BufferID;
+
+		friend class OpenCLProgram;
 	};
 }
\ No newline at end of file
@@ -15,9 +15,12 @@
 namespace Engine
 {
 	cl_device_id OpenCLContext::s_Device = nullptr;
+	std::vector<cl_device_id> OpenCLContext::s_Devices;
 	cl_platform_id OpenCLContext::s_Platform = nullptr;
 	cl_context OpenCLContext::s_Context = nullptr;
 	bool OpenCLContext::s_Debug = true;
+	bool OpenCLContext::s_GLSharing = false;
+	clCreateEventFromGLsyncKHR_fn OpenCLContext::s_CreateEventFromGLsync = nullptr;
 
 	struct errorcode
 	{
@@ -118,10 +121,38 @@ namespace Engine
 	}
 
 
-	void OpenCLContext::Initialize()
+	bool OpenCLContext::Initialize(bool glSharing, bool allDevices)
 	{
 		SelectOpenCLDevice();
 
+		if (s_Device == nullptr)
+			return false;
+
+		cl_int status;
+		s_Devices = { s_Device };
+
+		if (!glSharing)
+		{
+			cl_context_properties props[] =
+			{
+				CL_CONTEXT_PLATFORM, (cl_context_properties)s_Platform,
+				0
+			};
+
+			if (allDevices)
+			{
+				s_Devices = CollectPlatformDevices();
+				s_Device = s_Devices[0];
+			}
+
+			s_Context = clCreateContext(props, (cl_uint)s_Devices.size(), s_Devices.data(), NULL, NULL, &status);
+			PrintCLError(status, "clCreateContext failed");
+			return status == CL_SUCCESS;
+		}
+
+		if (allDevices)
+			LOG_WARN("GL sharing uses the single best OpenCL device -- ignoring the request for all devices.");
+
 		if (IsCLExtensionSupported("cl_khr_gl_sharing"))
 		{
 			LOG_TRACE("cl_khr_gl_sharing is supported.");
@@ -129,10 +160,9 @@ namespace Engine
 		else
 		{
 			LOG_CRITICAL("cl_khr_gl_sharing is not supported -- aborting.");
-			return;
+			return false;
 		}
 
-		cl_int status;
 		cl_context_properties props[] =
 		{
 			CL_GL_CONTEXT_KHR, (cl_context_properties)wglGetCurrentContext(),
@@ -143,6 +173,106 @@ namespace Engine
 
 		s_Context = clCreateContext(props, 1, &s_Device, NULL, NULL, &status);
 		PrintCLError(status, "clCreateContext failed");
+		s_GLSharing = status == CL_SUCCESS;
+
+		if (s_GLSharing && IsCLExtensionSupported("cl_khr_gl_event"))
+		{
+			s_CreateEventFromGLsync = (clCreateEventFromGLsyncKHR_fn)clGetExtensionFunctionAddressForPlatform(s_Platform, "clCreateEventFromGLsyncKHR");
+			LOG_TRACE("cl_khr_gl_event is {}.", s_CreateEventFromGLsync != nullptr ? "supported" : "advertised but not loadable");
+		}
+
+		return status == CL_SUCCESS;
+	}
+
+	std::vector<cl_device_id> OpenCLContext::CollectPlatformDevices()
+	{
+		cl_uint numDevices = 0;
+		clGetDeviceIDs(s_Platform, CL_DEVICE_TYPE_ALL, 0, NULL, &numDevices);
+		std::vector<cl_device_id> platformDevices(numDevices);
+		cl_int status = clGetDeviceIDs(s_Platform, CL_DEVICE_TYPE_ALL, numDevices, platformDevices.data(), NULL);
+		PrintCLError(status, "clGetDeviceIDs failed (3)");
+
+		// The best device leads, so everything that only uses one device keeps using it.
+		std::vector<cl_device_id> devices = { s_Device };
+		for (cl_device_id device : platformDevices)
+			if (device != s_Device)
+				devices.push_back(device);
+
+		std::vector<cl_device_id> result;
+		for (cl_device_id device : devices)
+		{
+			cl_device_type type;
+			clGetDeviceInfo(device, CL_DEVICE_TYPE, sizeof(type), &type, NULL);
+
+			// A sub-device per NUMA node keeps each node's threads on its own memory.  Devices
+			// that can't be split, or only have one node, are used whole.
+			cl_uint subDeviceCount = 0;
+			const cl_device_partition_property numa[] = { CL_DEVICE_PARTITION_BY_AFFINITY_DOMAIN, CL_DEVICE_AFFINITY_DOMAIN_NUMA, 0 };
+			if (type == CL_DEVICE_TYPE_CPU && clCreateSubDevices(device, numa, 0, NULL, &subDeviceCount) == CL_SUCCESS && subDeviceCount > 1)
+			{
+				std::vector<cl_device_id> subDevices(subDeviceCount);
+				status = clCreateSubDevices(device, numa, subDeviceCount, subDevices.data(), NULL);
+				PrintCLError(status, "clCreateSubDevices failed");
+				if (status == CL_SUCCESS)
+				{
+					LOG_INFO("Split {} into {} NUMA sub-devices.", GetDeviceName(device), subDeviceCount);
+					result.insert(result.end(), subDevices.begin(), subDevices.end());
+					continue;
+				}
+			}
+
+			result.push_back(device);
+		}
+
+		for (size_t i = 0; i < result.size(); i++)
+			LOG_INFO("OpenCL device #{}: {}", i, GetDeviceName(result[i]));
+
+		return result;
+	}
+
+	bool OpenCLContext::IsHostUnifiedMemory()
+	{
+		// Deprecated by OpenCL 2.0, but every 1.x driver still reports it.
+		for (cl_device_id device : s_Devices)
+		{
+			cl_bool unified = CL_FALSE;
+			if (clGetDeviceInfo(device, CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(unified), &unified, NULL) != CL_SUCCESS || !unified)
+				return false;
+		}
+		return !s_Devices.empty();
+	}
+
+	bool OpenCLContext::IsCorrectlyRoundedDivideSqrtSupported()
+	{
+		for (cl_device_id device : s_Devices)
+		{
+			cl_device_fp_config config = 0;
+			if (clGetDeviceInfo(device, CL_DEVICE_SINGLE_FP_CONFIG, sizeof(config), &config, NULL) != CL_SUCCESS || !(config & CL_FP_CORRECTLY_ROUNDED_DIVIDE_SQRT))
+				return false;
+		}
+		return !s_Devices.empty();
+	}
+
+	cl_event OpenCLContext::CreateEventFromGLFence(cl_GLsync fence)
+	{
+		if (s_CreateEventFromGLsync == nullptr || fence == nullptr)
+			return nullptr;
+
+		cl_int status;
+		cl_event event = s_CreateEventFromGLsync(s_Context, fence, &status);
+		PrintCLError(status, "clCreateEventFromGLsyncKHR failed");
+		return status == CL_SUCCESS ? event : nullptr;
+	}
+
+	void OpenCLContext::WaitForEvent(cl_event& event)
+	{
+		if (event == nullptr)
+			return;
+
+		cl_int status = clWaitForEvents(1, &event);
+		PrintCLError(status, "clWaitForEvents failed");
+		clReleaseEvent(event);
+		event = nullptr;
 	}
 
 	static char* Vendor(cl_uint v)
@@ -173,6 +303,41 @@ namespace Engine
 		return (char*)"Unknown";
 	}
 
+	std::string OpenCLContext::GetDeviceName(cl_device_id device)
+	{
+		if (device == nullptr && s_Device == nullptr)
+			return "None";
+
+		return GetDeviceInfoString(CL_DEVICE_NAME, device);
+	}
+
+	std::string OpenCLContext::GetDeviceInfoString(cl_device_info param, cl_device_id device)
+	{
+		if (device == nullptr)
+			device = s_Device;
+
+		size_t size = 0;
+		if (device == nullptr || clGetDeviceInfo(device, param, 0, NULL, &size) != CL_SUCCESS)
+			return "";
+
+		std::string value(size, '\0');
+		clGetDeviceInfo(device, param, size, &value[0], NULL);
+		value.resize(strlen(value.c_str()));
+		return value;
+	}
+
+	std::string OpenCLContext::GetPlatformInfoString(cl_platform_info param)
+	{
+		size_t size = 0;
+		if (s_Platform == nullptr || clGetPlatformInfo(s_Platform, param, 0, NULL, &size) != CL_SUCCESS)
+			return "";
+
+		std::string value(size, '\0');
+		clGetPlatformInfo(s_Platform, param, size, &value[0], NULL);
+		value.resize(strlen(value.c_str()));
+		return value;
+	}
+
 	void OpenCLContext::Wait(cl_command_queue queue)
 	{
 		cl_event wait;
@@ -185,6 +350,8 @@ namespace Engine
 		status = clWaitForEvents(1, &wait);
 		if (status != CL_SUCCESS)
 			LOG_ERROR("Wait: clWaitForEvents failed!");
+
+		clReleaseEvent(wait);
 	}
 
 	int OpenCLContext::BitCheck(float fp)
@@ -222,10 +389,13 @@ namespace Engine
 		cl_uint bestDeviceVendor;
 		cl_int status;
 
-		cl_uint numPlatforms;
+		cl_uint numPlatforms = 0;
 		status = clGetPlatformIDs(0, NULL, &numPlatforms);
-		if (status != CL_SUCCESS)
+		if (status != CL_SUCCESS || numPlatforms == 0)
+		{
 			LOG_CRITICAL("clGetPlatformIDs failed (1)");
+			return;
+		}
 
 		cl_platform_id* platforms = new cl_platform_id[numPlatforms];
 		status = clGetPlatformIDs(numPlatforms, platforms, NULL);
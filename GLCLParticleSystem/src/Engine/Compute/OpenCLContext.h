@@ -10,9 +10,13 @@ namespace Engine
 	class OpenCLContext
 	{
 	public:
-		static void Initialize();
+		// With glSharing false the context has no GL interop and works without a window.
+		// allDevices puts every device of the selected platform in the context, with CPUs split
+		// into one sub-device per NUMA node.  GL-shared contexts keep the single best device.
+		static bool Initialize(bool glSharing = true, bool allDevices = false);
 
 		static void SelectOpenCLDevice();
+		// Blocks until everything enqueued on the queue has completed.
 		static void Wait(cl_command_queue queue);
 		static int BitCheck(float fp);
 
@@ -20,18 +24,42 @@ namespace Engine
 
 		static cl_platform_id GetPlatform() { return s_Platform; }
 		static cl_device_id GetDevice() { return s_Device; }
+		// Every device in the context.  The first is always GetDevice().
+		static const std::vector<cl_device_id>& GetDevices() { return s_Devices; }
 		static cl_context GetContext() { return s_Context; }
 
 		static cl_device_id& GetDeviceRef() { return s_Device; }
+		static std::string GetDeviceName(cl_device_id device = nullptr);
+		// String-valued device and platform queries, empty when unavailable.  A null device means GetDevice().
+		static std::string GetDeviceInfoString(cl_device_info param, cl_device_id device = nullptr);
+		static std::string GetPlatformInfoString(cl_platform_info param);
+		static bool IsGLSharingEnabled() { return s_GLSharing; }
+		// True when every device in the context works out of host memory, as CPUs and most
+		// integrated GPUs do.  Buffers then live in host-mappable memory; see OpenCLBuffer.
+		static bool IsHostUnifiedMemory();
+		// True when every device in the context can build with -cl-fp32-correctly-rounded-divide-sqrt.
+		static bool IsCorrectlyRoundedDivideSqrtSupported();
+		// cl_khr_gl_event: GL fences can be waited on by the device instead of the host.
+		static bool IsGLEventSupported() { return s_CreateEventFromGLsync != nullptr; }
+		// Null when cl_khr_gl_event is unavailable; the caller then waits on the fence itself.
+		static cl_event CreateEventFromGLFence(cl_GLsync fence);
+		// Blocks on the event, then releases it and clears the handle.  Null handles are ignored.
+		static void WaitForEvent(cl_event& event);
 		static void ToggleDebug(bool debug) { s_Debug = debug; }
 		static bool GetShouldLogDebug() { return s_Debug; }
 		static bool IsCLExtensionSupported(const char* extension);
 
 	private:
+		// The platform's devices for a multi-device context, NUMA CPUs split into sub-devices.
+		static std::vector<cl_device_id> CollectPlatformDevices();
+
 
 		static bool s_Debug;
+		static bool s_GLSharing;
 		static cl_platform_id s_Platform;
 		static cl_device_id s_Device;
+		static std::vector<cl_device_id> s_Devices;
 		static cl_context s_Context;
+		static clCreateEventFromGLsyncKHR_fn s_CreateEventFromGLsync;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,284 @@
+#include "glclpch.h"
+#include "Engine/Compute/OpenCLGraph.h"
+
+#include <unordered_set>
+
+namespace Engine
+{
+	static std::string JoinBufferNames(const std::vector<OpenCLBuffer*>& buffers)
+	{
+		std::string names;
+		for (OpenCLBuffer* buffer : buffers)
+			names += (names.empty() ? "" : "+") + buffer->GetBufferName();
+		return names;
+	}
+
+	OpenCLGraph::OpenCLGraph(OpenCLProgram* program, const std::string& name)
+		:m_Program(program), m_Name(name)
+	{
+	}
+
+	OpenCLGraph::NodeID OpenCLGraph::AddNode(Node&& node)
+	{
+		if (m_Built)
+		{
+			LOG_ERROR("Graph '{}': cannot add node '{}' after Build().", m_Name, node.Name);
+			return (NodeID)m_Nodes.size() - 1;
+		}
+
+		m_Nodes.push_back(std::move(node));
+		return (NodeID)m_Nodes.size() - 1;
+	}
+
+	OpenCLGraph::NodeID OpenCLGraph::AddKernel(OpenCLKernel* kernel, const glm::ivec3& globalWorkSize, const glm::ivec3& localWorkSize, const GraphAccess& access, const std::vector<Binding>& bindings)
+	{
+		Node node;
+		node.Type = GraphNodeType::Kernel;
+		node.Name = kernel->GetKernelName();
+		node.Access = access;
+		node.Kernel = kernel;
+		node.GlobalWorkSize = globalWorkSize;
+		node.LocalWorkSize = localWorkSize;
+		node.Bindings = bindings;
+		return AddNode(std::move(node));
+	}
+
+	OpenCLGraph::NodeID OpenCLGraph::AddUpload(OpenCLBuffer* buffer, size_t size, const void* data)
+	{
+		Node node;
+		node.Type = GraphNodeType::Upload;
+		node.Name = buffer->GetBufferName();
+		node.Access.Writes = { buffer };
+		node.UploadSize = size;
+		node.UploadData = data;
+		return AddNode(std::move(node));
+	}
+
+	OpenCLGraph::NodeID OpenCLGraph::AddAcquire(const std::vector<OpenCLBuffer*>& buffers)
+	{
+		// Ownership moves to CL, which orders the acquire like a write.
+		Node node;
+		node.Type = GraphNodeType::Acquire;
+		node.Name = JoinBufferNames(buffers);
+		node.Access.Writes = buffers;
+		return AddNode(std::move(node));
+	}
+
+	OpenCLGraph::NodeID OpenCLGraph::AddRelease(const std::vector<OpenCLBuffer*>& buffers)
+	{
+		Node node;
+		node.Type = GraphNodeType::Release;
+		node.Name = JoinBufferNames(buffers);
+		node.Access.Writes = buffers;
+		return AddNode(std::move(node));
+	}
+
+	OpenCLGraph::NodeID OpenCLGraph::AddTask(const std::string& name, const GraphAccess& access, const std::function<void()>& enqueue)
+	{
+		Node node;
+		node.Type = GraphNodeType::Task;
+		node.Name = name;
+		node.Access = access;
+		node.Enqueue = enqueue;
+		return AddNode(std::move(node));
+	}
+
+	void OpenCLGraph::SetEnabled(NodeID node, bool enabled)
+	{
+		GraphNodeType type = m_Nodes[node].Type;
+		if (type == GraphNodeType::Acquire || type == GraphNodeType::Release)
+		{
+			LOG_WARN("Graph '{}': interop node '{}' can't be disabled.", m_Name, m_Nodes[node].Name);
+			return;
+		}
+
+		m_Nodes[node].Enabled = enabled;
+	}
+
+	void OpenCLGraph::Build()
+	{
+		DeriveDependencies();
+		ValidateInterop();
+		ScheduleSteps();
+		m_Built = true;
+
+		LOG_INFO("Graph '{}': {} nodes in {} steps.", m_Name, m_Nodes.size(), m_Steps.size());
+	}
+
+	void OpenCLGraph::DeriveDependencies()
+	{
+		std::unordered_map<OpenCLBuffer*, NodeID> lastWriter;
+		std::unordered_map<OpenCLBuffer*, std::vector<NodeID>> readersSinceWrite;
+
+		for (NodeID id = 0; id < (NodeID)m_Nodes.size(); id++)
+		{
+			Node& node = m_Nodes[id];
+			std::vector<NodeID>& dependencies = node.Dependencies;
+			dependencies.clear();
+
+			for (OpenCLBuffer* buffer : node.Access.Reads)
+			{
+				auto writer = lastWriter.find(buffer);
+				if (writer != lastWriter.end())
+					dependencies.push_back(writer->second);
+			}
+
+			for (OpenCLBuffer* buffer : node.Access.Writes)
+			{
+				auto writer = lastWriter.find(buffer);
+				if (writer != lastWriter.end())
+					dependencies.push_back(writer->second);
+
+				const std::vector<NodeID>& readers = readersSinceWrite[buffer];
+				dependencies.insert(dependencies.end(), readers.begin(), readers.end());
+			}
+
+			std::sort(dependencies.begin(), dependencies.end());
+			dependencies.erase(std::unique(dependencies.begin(), dependencies.end()), dependencies.end());
+			dependencies.erase(std::remove(dependencies.begin(), dependencies.end(), id), dependencies.end());
+
+			for (OpenCLBuffer* buffer : node.Access.Reads)
+				readersSinceWrite[buffer].push_back(id);
+
+			for (OpenCLBuffer* buffer : node.Access.Writes)
+			{
+				lastWriter[buffer] = id;
+				readersSinceWrite[buffer].clear();
+			}
+		}
+	}
+
+	void OpenCLGraph::ValidateInterop() const
+	{
+		std::unordered_set<OpenCLBuffer*> held;
+
+		for (const Node& node : m_Nodes)
+		{
+			if (node.Type == GraphNodeType::Acquire || node.Type == GraphNodeType::Release)
+			{
+				bool acquire = node.Type == GraphNodeType::Acquire;
+				for (OpenCLBuffer* buffer : node.Access.Writes)
+				{
+					if (!buffer->IsAttachedToGLBuffer())
+						LOG_ERROR("Graph '{}': '{}' is not associated with a GL buffer and can't be acquired or released.", m_Name, buffer->GetBufferName());
+					else if (acquire && !held.insert(buffer).second)
+						LOG_WARN("Graph '{}': '{}' is acquired twice.", m_Name, buffer->GetBufferName());
+					else if (!acquire && held.erase(buffer) == 0)
+						LOG_ERROR("Graph '{}': '{}' is released without being acquired.", m_Name, buffer->GetBufferName());
+				}
+				continue;
+			}
+
+			for (const std::vector<OpenCLBuffer*>* buffers : { &node.Access.Reads, &node.Access.Writes })
+				for (OpenCLBuffer* buffer : *buffers)
+					if (buffer->IsAttachedToGLBuffer() && held.find(buffer) == held.end())
+						LOG_ERROR("Graph '{}': node '{}' uses GL buffer '{}' without acquiring it.", m_Name, node.Name, buffer->GetBufferName());
+		}
+
+		for (OpenCLBuffer* buffer : held)
+			LOG_WARN("Graph '{}': '{}' is still acquired when the graph ends.", m_Name, buffer->GetBufferName());
+	}
+
+	void OpenCLGraph::ScheduleSteps()
+	{
+		m_Steps.clear();
+
+		for (NodeID id = 0; id < (NodeID)m_Nodes.size(); id++)
+		{
+			const Node& node = m_Nodes[id];
+
+			if (node.Type != GraphNodeType::Acquire && node.Type != GraphNodeType::Release)
+			{
+				m_Steps.push_back({ node.Type, id, {}, node.Name });
+				continue;
+			}
+
+			std::vector<OpenCLBuffer*> objects = node.Access.Writes;
+
+			// CL keeps anything released and immediately re-acquired, so neither call is needed.
+			if (node.Type == GraphNodeType::Acquire && !m_Steps.empty() && m_Steps.back().Type == GraphNodeType::Release)
+			{
+				std::vector<OpenCLBuffer*>& released = m_Steps.back().Buffers;
+				for (auto object = objects.begin(); object != objects.end();)
+				{
+					auto match = std::find(released.begin(), released.end(), *object);
+					if (match == released.end())
+					{
+						++object;
+						continue;
+					}
+
+					released.erase(match);
+					object = objects.erase(object);
+				}
+
+				if (released.empty())
+					m_Steps.pop_back();
+			}
+
+			if (objects.empty())
+				continue;
+
+			if (!m_Steps.empty() && m_Steps.back().Type == node.Type)
+			{
+				Step& merged = m_Steps.back();
+				merged.Buffers.insert(merged.Buffers.end(), objects.begin(), objects.end());
+				merged.Label += "+" + node.Name;
+				continue;
+			}
+
+			m_Steps.push_back({ node.Type, id, objects, node.Name });
+		}
+
+		// Resolved here so replays record the interop calls without a lookup.
+		for (Step& step : m_Steps)
+			if (step.Type == GraphNodeType::Acquire || step.Type == GraphNodeType::Release)
+				step.Stats = m_Program->GetProfiler().GetEntry(step.Label);
+	}
+
+	void OpenCLGraph::Replay(const std::vector<cl_event>& waitList, cl_event* completion)
+	{
+		if (!m_Built)
+		{
+			LOG_ERROR("Graph '{}' must be built before it is replayed.", m_Name);
+			return;
+		}
+
+		size_t lastRelease = m_Steps.size();
+		for (size_t i = 0; i < m_Steps.size(); i++)
+			if (m_Steps[i].Type == GraphNodeType::Release)
+				lastRelease = i;
+
+		bool firstAcquire = true;
+		for (size_t i = 0; i < m_Steps.size(); i++)
+		{
+			const Step& step = m_Steps[i];
+			Node& node = m_Nodes[step.Node];
+
+			switch (step.Type)
+			{
+			case GraphNodeType::Kernel:
+				if (!node.Enabled) break;
+				for (const Binding& binding : node.Bindings)
+					node.Kernel->SetArgData(binding.first, binding.second->GetBufferID());
+				m_Program->EnqueueKernel(node.Kernel, node.GlobalWorkSize, node.LocalWorkSize);
+				break;
+			case GraphNodeType::Upload:
+				if (!node.Enabled) break;
+				m_Program->EnqueueWrite(node.Access.Writes[0], node.UploadSize, node.UploadData);
+				break;
+			case GraphNodeType::Task:
+				if (!node.Enabled) break;
+				node.Enqueue();
+				break;
+			case GraphNodeType::Acquire:
+				m_Program->EnqueueGLObjects(true, step.Buffers, step.Stats, firstAcquire ? waitList : std::vector<cl_event>(), nullptr);
+				firstAcquire = false;
+				break;
+			case GraphNodeType::Release:
+				m_Program->EnqueueGLObjects(false, step.Buffers, step.Stats, {}, i == lastRelease ? completion : nullptr);
+				break;
+			}
+		}
+	}
+}
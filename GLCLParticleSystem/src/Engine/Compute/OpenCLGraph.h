@@ -0,0 +1,107 @@
+#pragma once
+
+#include <OpenCL/cl.h>
+#include "Engine/Compute/OpenCLProgram.h"
+
+#include <functional>
+
+namespace Engine
+{
+	// The buffers a graph node reads and writes.
+	struct GraphAccess
+	{
+		std::vector<OpenCLBuffer*> Reads;
+		std::vector<OpenCLBuffer*> Writes;
+	};
+
+	enum class GraphNodeType { Kernel, Upload, Acquire, Release, Task };
+
+	// A frame's device work, declared once and replayed every frame.
+	// Nodes are added in submission order together with the buffers they touch.  Build() derives
+	// every node's dependencies from those sets (read after write, write after read, write after
+	// write), checks that each GL-shared buffer is acquired wherever a node uses it, and merges
+	// adjacent acquires and adjacent releases into one interop call each.  A release followed
+	// directly by an acquire of the same buffer is dropped.  Replay() enqueues the result through
+	// resolved kernel and buffer pointers and never looks anything up by name.  Its interop calls
+	// count acquires like OpenCLProgram::AcquireGLObjects(), so buffers the caller already holds
+	// are left alone.
+	// The program's queue is in-order, so submission order already satisfies the dependencies;
+	// they describe how far a node could move for passes that reschedule the graph.
+	class OpenCLGraph
+	{
+	public:
+		using NodeID = uint32_t;
+		// Kernel argument index and the buffer bound to it before each launch.
+		using Binding = std::pair<uint32_t, OpenCLBuffer*>;
+
+		OpenCLGraph(OpenCLProgram* program, const std::string& name);
+
+		// Bindings let one kernel be replayed by several graphs against different buffers.
+		NodeID AddKernel(OpenCLKernel* kernel, const glm::ivec3& globalWorkSize, const glm::ivec3& localWorkSize, const GraphAccess& access, const std::vector<Binding>& bindings = {});
+		// Copies size bytes from data into buffer on every replay, from what data holds then.  The
+		// write is non-blocking: data must stay valid and unchanged until it completes on the device.
+		NodeID AddUpload(OpenCLBuffer* buffer, size_t size, const void* data);
+		NodeID AddAcquire(const std::vector<OpenCLBuffer*>& buffers);
+		NodeID AddRelease(const std::vector<OpenCLBuffer*>& buffers);
+		// Host code that enqueues its own commands, such as a multi-pass sort.
+		NodeID AddTask(const std::string& name, const GraphAccess& access, const std::function<void()>& enqueue);
+
+		// Disabled kernel, upload and task nodes are skipped by Replay() but keep their
+		// dependencies.  Acquires and releases are always replayed.
+		void SetEnabled(NodeID node, bool enabled);
+
+		// Derives dependencies and the interop schedule.  Nodes can't be added afterwards.
+		void Build();
+		// waitList gates the first acquire; completion, when given, receives a retained event
+		// for the last release that the caller must release.
+		void Replay(const std::vector<cl_event>& waitList = {}, cl_event* completion = nullptr);
+
+		// Earlier nodes that must complete before this one starts.
+		const std::vector<NodeID>& GetDependencies(NodeID node) const { return m_Nodes[node].Dependencies; }
+		size_t GetNodeCount() const { return m_Nodes.size(); }
+		const std::string& GetName() const { return m_Name; }
+
+	private:
+		struct Node
+		{
+			GraphNodeType Type;
+			std::string Name;
+			bool Enabled = true;
+			GraphAccess Access;
+			std::vector<NodeID> Dependencies;
+
+			OpenCLKernel* Kernel = nullptr;
+			glm::ivec3 GlobalWorkSize;
+			glm::ivec3 LocalWorkSize;
+			std::vector<Binding> Bindings;
+
+			size_t UploadSize = 0;
+			const void* UploadData = nullptr;
+
+			std::function<void()> Enqueue;
+		};
+
+		// One entry of the built schedule: a single node, or a merged interop call.
+		struct Step
+		{
+			GraphNodeType Type;
+			NodeID Node;
+			std::vector<OpenCLBuffer*> Buffers;
+			std::string Label;
+			// The profiler entry of Label, resolved once the schedule is built.
+			CLCommandStats* Stats = nullptr;
+		};
+
+		NodeID AddNode(Node&& node);
+		void DeriveDependencies();
+		void ValidateInterop() const;
+		void ScheduleSteps();
+
+	private:
+		OpenCLProgram* m_Program;
+		std::string m_Name;
+		std::vector<Node> m_Nodes;
+		std::vector<Step> m_Steps;
+		bool m_Built = false;
+	};
+}
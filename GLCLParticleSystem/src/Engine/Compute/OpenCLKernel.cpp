@@ -5,13 +5,33 @@
 
 namespace Engine
 {
+	KernelArg* KernelArg::FromBuffer(OpenCLBuffer* buffer)
+	{
+		return new KernelArg(buffer->GetBufferName(), buffer->GetBufferID(), OpenCLBuffer::NativeSize(), KernelArgType::Global);
+	}
+
+	KernelArg* KernelArg::FromValue(const std::string& name, void* value, size_t size)
+	{
+		return new KernelArg(name, value, size, KernelArgType::Value);
+	}
+
 	OpenCLKernel::OpenCLKernel(Engine::OpenCLProgram* program, const std::string& kernelName, const std::initializer_list<KernelArg*>& args)
-		:m_KernelName(kernelName), m_Program(program), m_Args(args)
+		:m_KernelName(kernelName), m_Program(program), m_Args(args), m_BoundArgs(args.size())
 	{
 		cl_int status;
 		m_KernelID = clCreateKernel(program->GetID(), kernelName.c_str(), &status);
 		if (status != CL_SUCCESS)
 			LOG_ERROR("clCreateKernel failed");
+
+		// Built once so launches don't format a string each.
+		size_t deviceCount = OpenCLContext::GetDevices().size();
+		if (deviceCount > 1)
+		{
+			for (size_t i = 0; i < deviceCount; i++)
+				m_DeviceLabels.push_back(m_KernelName + "@" + std::to_string(i));
+		}
+		for (size_t i = 0; i < std::max<size_t>(deviceCount, 1); i++)
+			m_DeviceStats.push_back(program->GetProfiler().GetEntry(GetProfileLabel((uint32_t)i)));
 	}
 
 	OpenCLKernel::~OpenCLKernel()
@@ -21,6 +41,8 @@ namespace Engine
 			if (!arg) continue;
 			delete arg;
 		}
+
+		clReleaseKernel(m_KernelID);
 	}
 
 	void OpenCLKernel::AttachArgs()
@@ -30,11 +52,28 @@ namespace Engine
 		for (int i = 0; i < m_Args.size(); i++)
 		{
 			KernelArg& arg = *m_Args[i];
-			
-			status = clSetKernelArg(m_KernelID, i, arg.Size, arg.Type == KernelArgType::Global ? &arg.Data : NULL);
+			BoundArg& bound = m_BoundArgs[i];
+
+			const void* value = arg.Type == KernelArgType::Global ? &arg.Data : arg.Type == KernelArgType::Value ? arg.Data : NULL;
+
+			// Local args have no value, so their size is what gets compared.
+			const uint8_t* key = (const uint8_t*)(value != NULL ? value : &arg.Size);
+			size_t keySize = value != NULL ? arg.Size : sizeof(arg.Size);
+
+			if (bound.Valid && bound.Bytes.size() == keySize && memcmp(bound.Bytes.data(), key, keySize) == 0)
+				continue;
+
+			status = clSetKernelArg(m_KernelID, i, arg.Size, value);
 			OpenCLContext::PrintCLError(status, "Failure to set clSetKernelArg for Arg");
+
+			bound.Valid = status == CL_SUCCESS;
+			bound.Bytes.assign(key, key + keySize);
 		}
+	}
 
-		OpenCLContext::Wait(m_Program->GetCommandQueueID());
+	void OpenCLKernel::InvalidateArgs()
+	{
+		for (BoundArg& bound : m_BoundArgs)
+			bound.Valid = false;
 	}
 }
\ No newline at end of file
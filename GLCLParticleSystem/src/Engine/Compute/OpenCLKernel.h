@@ -6,14 +6,21 @@
 namespace Engine
 {
 	class OpenCLProgram;
+	class OpenCLBuffer;
+	struct CLCommandStats;
 
-	enum class KernelArgType { None, Global, Local };
+	// Global: Data is the cl_mem itself.  Local: Size bytes of local memory, Data unused.
+	// Value: Data points at Size bytes of host memory that are copied when the args are attached.
+	enum class KernelArgType { None, Global, Local, Value };
 
 	struct KernelArg
 	{
 		KernelArg(const std::string& name, void* data, size_t size, KernelArgType argType)
 			:Name(name), Data(data), Size(size), Type(argType) { }
 
+		static KernelArg* FromBuffer(OpenCLBuffer* buffer);
+		static KernelArg* FromValue(const std::string& name, void* value, size_t size);
+
 		std::string Name;
 		void* Data;
 		size_t Size;
@@ -27,12 +34,39 @@ namespace Engine
 		~OpenCLKernel();
 
 		const std::string& GetKernelName() const { return m_KernelName; }
+		// What the profiler records a launch on device as: the name, with "@device" appended
+		// when the context has several devices.
+		const std::string& GetProfileLabel(uint32_t device) const { return device < m_DeviceLabels.size() ? m_DeviceLabels[device] : m_KernelName; }
+		// The profiler entry of that label, resolved when the kernel is created.
+		CLCommandStats* GetProfileStats(uint32_t device) const { return m_DeviceStats[device < m_DeviceStats.size() ? device : 0]; }
 		cl_kernel GetID() const { return m_KernelID; }
+		// Passes every argument whose value changed since it was last bound to clSetKernelArg.
+		// Never waits on the queue: the runtime captures argument values at enqueue time.
 		void AttachArgs();
+		// Rebinds an argument.  Takes effect the next time the args are attached.
+		void SetArgData(uint32_t index, void* data) { m_Args[index]->Data = data; }
+		uint32_t GetArgCount() const { return (uint32_t)m_Args.size(); }
+		// Forces every argument to be rebound on the next attach.
+		void InvalidateArgs();
+
+		// Global memory traffic of one work-item, used to derive the kernel's effective bandwidth.
+		void SetBytesPerWorkItem(size_t bytes) { m_BytesPerWorkItem = bytes; }
+		size_t GetBytesPerWorkItem() const { return m_BytesPerWorkItem; }
 
 	private:
+		// What was last passed to clSetKernelArg for one argument.
+		struct BoundArg
+		{
+			bool Valid = false;
+			std::vector<uint8_t> Bytes;
+		};
+
+		size_t m_BytesPerWorkItem = 0;
 		std::vector<KernelArg*> m_Args;
+		std::vector<BoundArg> m_BoundArgs;
 		std::string m_KernelName;
+		std::vector<std::string> m_DeviceLabels;
+		std::vector<CLCommandStats*> m_DeviceStats;
 		cl_kernel m_KernelID;
 		OpenCLProgram* m_Program;
 	};
@@ -0,0 +1,135 @@
+#include "glclpch.h"
+#include "Engine/Compute/OpenCLProfiler.h"
+#include "Engine/Compute/OpenCLContext.h"
+
+#include <cmath>
+
+namespace Engine
+{
+	const char* CLCommandTypeName(CLCommandType type)
+	{
+		switch (type)
+		{
+		case CLCommandType::Kernel: return "kernel";
+		case CLCommandType::Write: return "write";
+		case CLCommandType::Read: return "read";
+		case CLCommandType::Copy: return "copy";
+		case CLCommandType::Acquire: return "acquire";
+		case CLCommandType::Release: return "release";
+		}
+
+		return "unknown";
+	}
+
+	static cl_ulong ProfilingInfo(cl_event event, cl_profiling_info info)
+	{
+		cl_ulong value = 0;
+		cl_int status = clGetEventProfilingInfo(event, info, sizeof(cl_ulong), &value, NULL);
+		OpenCLContext::PrintCLError(status, "clGetEventProfilingInfo failed");
+		return value;
+	}
+
+	OpenCLProfiler::~OpenCLProfiler()
+	{
+		for (const PendingCommand& command : m_Pending)
+			clReleaseEvent(command.Event);
+	}
+
+	void OpenCLProfiler::Record(CLCommandStats* stats, CLCommandType type, cl_event event, size_t bytes)
+	{
+		if (event == nullptr)
+			return;
+
+		if (!m_Enabled)
+		{
+			clReleaseEvent(event);
+			return;
+		}
+
+		stats->Type = type;
+		m_Pending.push_back({ stats, event, bytes });
+	}
+
+	static bool IsComplete(cl_event event)
+	{
+		cl_int executionStatus = CL_QUEUED;
+		clGetEventInfo(event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &executionStatus, NULL);
+		// Failed commands report a negative status; they are done too.
+		return executionStatus <= CL_COMPLETE;
+	}
+
+	void OpenCLProfiler::Resolve()
+	{
+		// Commands complete in order on our queues, so stop at the first one still running.
+		size_t resolved = 0;
+		for (const PendingCommand& command : m_Pending)
+		{
+			if (!IsComplete(command.Event))
+				break;
+			resolved++;
+
+			cl_ulong queued = ProfilingInfo(command.Event, CL_PROFILING_COMMAND_QUEUED);
+			cl_ulong submit = ProfilingInfo(command.Event, CL_PROFILING_COMMAND_SUBMIT);
+			cl_ulong start = ProfilingInfo(command.Event, CL_PROFILING_COMMAND_START);
+			cl_ulong end = ProfilingInfo(command.Event, CL_PROFILING_COMMAND_END);
+			clReleaseEvent(command.Event);
+
+			// Timestamps are in nanoseconds.
+			double durationMS = (end - start) * 1.0e-6;
+			CLCommandStats& stats = *command.Stats;
+
+			stats.MinMS = stats.Count == 0 ? durationMS : std::min(stats.MinMS, durationMS);
+			stats.MaxMS = stats.Count == 0 ? durationMS : std::max(stats.MaxMS, durationMS);
+			stats.Count++;
+			stats.Bytes += command.Bytes;
+			stats.SumMS += durationMS;
+			stats.SumQueuedToSubmitMS += (submit - queued) * 1.0e-6;
+			stats.SumSubmitToStartMS += (start - submit) * 1.0e-6;
+
+			double durationUS = durationMS * 1000.0;
+			size_t bucket = durationUS < 1.0 ? 0 : std::min<size_t>((size_t)std::log2(durationUS), CLCommandStats::HistogramBuckets - 1);
+			stats.Histogram[bucket]++;
+
+			if (stats.Type == CLCommandType::Kernel)
+				m_KernelTimeS += durationMS / 1000.0;
+		}
+
+		m_Pending.erase(m_Pending.begin(), m_Pending.begin() + resolved);
+	}
+
+	void OpenCLProfiler::Reset()
+	{
+		for (const PendingCommand& command : m_Pending)
+			clReleaseEvent(command.Event);
+
+		m_Pending.clear();
+		for (auto& entry : m_Stats)
+		{
+			CLCommandStats cleared;
+			cleared.Type = entry.second.Type;
+			entry.second = cleared;
+		}
+		m_KernelTimeS = 0.0;
+	}
+
+	void OpenCLProfiler::LogReport() const
+	{
+		for (const auto& entry : m_Stats)
+		{
+			const CLCommandStats& stats = entry.second;
+			if (stats.Count == 0)
+				continue;
+
+			LOG_INFO("{} [{}]: {} calls, mean {:.3f} ms, min {:.3f} ms, max {:.3f} ms, queue->start {:.3f} ms, {:.2f} GB/s",
+				entry.first, CLCommandTypeName(stats.Type), stats.Count, stats.GetMeanMS(), stats.MinMS, stats.MaxMS,
+				stats.Count > 0 ? (stats.SumQueuedToSubmitMS + stats.SumSubmitToStartMS) / stats.Count : 0.0, stats.GetBandwidthGBs());
+
+			std::stringstream histogram;
+			for (size_t i = 0; i < CLCommandStats::HistogramBuckets; i++)
+				if (stats.Histogram[i] > 0)
+					histogram << " [" << (1ull << i) << "us: " << stats.Histogram[i] << "]";
+
+			LOG_INFO("  histogram:{}", histogram.str());
+		}
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <OpenCL/cl.h>
+#include <OpenCL/cl_platform.h>
+
+#include <array>
+#include <map>
+
+namespace Engine
+{
+	enum class CLCommandType { Kernel, Write, Read, Copy, Acquire, Release };
+
+	// Aggregated device timings for every command enqueued under one name.
+	struct CLCommandStats
+	{
+		// Bucket i counts commands whose device duration fell in [2^i, 2^(i+1)) microseconds.
+		static constexpr size_t HistogramBuckets = 24;
+
+		CLCommandType Type = CLCommandType::Kernel;
+		size_t Count = 0;
+		size_t Bytes = 0;
+		double SumMS = 0.0;
+		double MinMS = 0.0;
+		double MaxMS = 0.0;
+		// Queued -> submit and submit -> start, summed so the host/driver overhead is visible.
+		double SumQueuedToSubmitMS = 0.0;
+		double SumSubmitToStartMS = 0.0;
+		std::array<uint32_t, HistogramBuckets> Histogram{};
+
+		double GetMeanMS() const { return Count > 0 ? SumMS / Count : 0.0; }
+		// Effective bandwidth from the bytes each command reported moving.
+		double GetBandwidthGBs() const { return SumMS > 0.0 ? Bytes / (SumMS * 1.0e6) : 0.0; }
+	};
+
+	// Collects CL_QUEUE_PROFILING_ENABLE timestamps for the commands an OpenCLProgram enqueues.
+	// Events are held until Resolve(), which reads their timestamps and releases them.
+	class OpenCLProfiler
+	{
+	public:
+		~OpenCLProfiler();
+
+		// The stats commands named name are recorded into.  Entries are never removed, Reset()
+		// only clears them, so callers resolve theirs once and record through the pointer.
+		CLCommandStats* GetEntry(const std::string& name) { return &m_Stats[name]; }
+		void Record(CLCommandStats* stats, CLCommandType type, cl_event event, size_t bytes);
+		// Reads back every command that has completed, oldest first; the rest stay pending.
+		void Resolve();
+		void Reset();
+		void LogReport() const;
+		// While disabled, commands are not recorded and their events are released immediately.
+		void SetEnabled(bool enabled) { m_Enabled = enabled; }
+		bool IsEnabled() const { return m_Enabled; }
+
+		// Every entry resolved so far, including ones with nothing recorded since the last Reset().
+		const std::map<std::string, CLCommandStats>& GetStats() const { return m_Stats; }
+		// Device time of every kernel resolved so far, in seconds.
+		double GetKernelTime() const { return m_KernelTimeS; }
+
+	private:
+		struct PendingCommand
+		{
+			CLCommandStats* Stats;
+			cl_event Event;
+			size_t Bytes;
+		};
+
+		bool m_Enabled = true;
+		std::vector<PendingCommand> m_Pending;
+		std::map<std::string, CLCommandStats> m_Stats;
+		double m_KernelTimeS = 0.0;
+	};
+
+	const char* CLCommandTypeName(CLCommandType type);
+}
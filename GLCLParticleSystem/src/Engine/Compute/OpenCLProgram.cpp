@@ -1,13 +1,17 @@
 #include "glclpch.h"
 #include "Engine/Compute/OpenCLProgram.h"
 #include "Engine/Compute/OpenCLContext.h"
+#include "Engine/Compute/OpenCLBinaryCache.h"
 #include <OpenCL/cl_gl.h>
 #include <OpenCL/cl_gl_ext.h>
 
 
 namespace Engine
 {
-	OpenCLProgram::OpenCLProgram(const std::string& source)
+	std::unordered_map<uint64_t, cl_program> OpenCLProgram::s_Variants;
+
+	OpenCLProgram::OpenCLProgram(const std::string& source, const std::string& buildOptions)
+		:m_BuildOptions(buildOptions)
 	{
 		FILE* fp;
 		errno_t err = fopen_s(&fp, source.c_str(), "r");
@@ -19,132 +23,245 @@ namespace Engine
 		fseek(fp, 0, SEEK_SET);
 		char* clProgramText = new char[fileSize + 1];		// leave room for '\0'
 		size_t n = fread(clProgramText, 1, fileSize, fp);
-		clProgramText[fileSize] = '\0';
+		// Text mode drops carriage returns, so n can be short of fileSize.  Whatever follows
+		// would otherwise be compiled, and hashed into the cache key.
+		clProgramText[n] = '\0';
 		fclose(fp);
 		if (n != fileSize)
 			LOG_ERROR("Expected to read {} bytes read from {} -- actually read {}.", fileSize, source.c_str(), n);
 
-		char* strings[1];
-		strings[0] = clProgramText;
+		std::string programSource(clProgramText, n);
+		uint64_t cacheKey = OpenCLBinaryCache::ComputeKey(programSource, m_BuildOptions);
+		m_CacheKey = cacheKey;
+
+		// The in-process cache also has to tell contexts apart; the disk cache only sees devices.
+		cl_context context = OpenCLContext::GetContext();
+		uint64_t variantKey = HashBytes(&context, sizeof(context), cacheKey);
+
+		auto variant = s_Variants.find(variantKey);
+		if (variant != s_Variants.end())
+		{
+			m_ID = variant->second;
+			clRetainProgram(m_ID);
+		}
+		else
+		{
+			m_ID = OpenCLBinaryCache::Load(cacheKey, m_BuildOptions);
+			bool built = m_ID != nullptr || BuildFromSource(clProgramText, m_BuildOptions, cacheKey);
+
+			// A failed build is retried by the next program rather than handed out again.
+			if (built)
+			{
+				LOG_INFO("Built OpenCL program {} with options '{}'.", source, m_BuildOptions);
+				s_Variants[variantKey] = m_ID;
+				clRetainProgram(m_ID);
+			}
+		}
+		delete[] clProgramText;
 
+		// One in-order queue per device.  Everything not aimed at a device runs on the first.
+		for (cl_device_id device : OpenCLContext::GetDevices())
+		{
+			cl_int status;
+			cl_command_queue queue = clCreateCommandQueue(OpenCLContext::GetContext(), device, CL_QUEUE_PROFILING_ENABLE, &status);
+			OpenCLContext::PrintCLError(status, "clCreateCommandQueue failed");
+			m_CommandQueues.push_back(queue);
+		}
+		m_CommandQueue = m_CommandQueues[0];
+	}
+
+	bool OpenCLProgram::BuildFromSource(const char* source, const std::string& options, uint64_t cacheKey)
+	{
 		cl_int status;
 
-		m_ID = clCreateProgramWithSource(OpenCLContext::GetContext(), 1, (const char**)strings, NULL, &status);
+		m_ID = clCreateProgramWithSource(OpenCLContext::GetContext(), 1, &source, NULL, &status);
 		OpenCLContext::PrintCLError(status, "clCreateProgramWithSource failed");
-		delete[] clProgramText;
 
-		char* options = { "" };
-		const cl_device_id id = OpenCLContext::GetDeviceRef();
-		status = clBuildProgram(m_ID, 1, &id, options, NULL, NULL);
+		const std::vector<cl_device_id>& devices = OpenCLContext::GetDevices();
+		status = clBuildProgram(m_ID, (cl_uint)devices.size(), devices.data(), options.c_str(), NULL, NULL);
 		if (status != CL_SUCCESS)
 		{
-			size_t size;
-			clGetProgramBuildInfo(m_ID, OpenCLContext::GetDevice(), CL_PROGRAM_BUILD_LOG, 0, NULL, &size);
-			cl_char* log = new cl_char[size];
-			clGetProgramBuildInfo(m_ID, OpenCLContext::GetDevice(), CL_PROGRAM_BUILD_LOG, size, log, NULL);
-			LOG_ERROR("clBuildProgram failed:\n{}", log);
-			delete[] log;
+			for (cl_device_id device : devices)
+			{
+				size_t size;
+				clGetProgramBuildInfo(m_ID, device, CL_PROGRAM_BUILD_LOG, 0, NULL, &size);
+				cl_char* log = new cl_char[size];
+				clGetProgramBuildInfo(m_ID, device, CL_PROGRAM_BUILD_LOG, size, log, NULL);
+				LOG_ERROR("clBuildProgram failed on {}:\n{}", OpenCLContext::GetDeviceName(device), log);
+				delete[] log;
+			}
+			return false;
 		}
 
+		OpenCLBinaryCache::Store(cacheKey, m_ID);
+		return true;
+	}
 
-		m_CommandQueue = clCreateCommandQueue(OpenCLContext::GetContext(), OpenCLContext::GetDevice(), 0, &status);
-		OpenCLContext::PrintCLError(status, "clCreateCommandQueue failed");
+	void OpenCLProgram::ReleaseVariants()
+	{
+		for (auto& variant : s_Variants)
+			clReleaseProgram(variant.second);
+		s_Variants.clear();
 	}
 
 	OpenCLProgram::~OpenCLProgram()
 	{
-		for (auto kernelEntry : m_Kernels)
-			delete kernelEntry.second;
+		for (OpenCLKernel* kernel : m_Kernels)
+			delete kernel;
+
+		for (OpenCLBuffer* buffer : m_Buffers)
+			delete buffer;
 
-		for (auto bufferEntry : m_Buffers)
-			delete bufferEntry.second;
+		m_Profiler.Reset();
+		for (cl_command_queue queue : m_CommandQueues)
+			clReleaseCommandQueue(queue);
+		clReleaseProgram(m_ID);
 	}
 
-	void OpenCLProgram::AddKernel(const std::string& kernelName, const std::initializer_list<KernelArg*>& args)
+	KernelHandle OpenCLProgram::AddKernel(const std::string& kernelName, const std::initializer_list<KernelArg*>& args)
 	{
-		if (OpenCLContext::GetShouldLogDebug() && m_Kernels.find(kernelName) != m_Kernels.end())
+		if (m_KernelIndices.find(kernelName) != m_KernelIndices.end())
 		{
 			LOG_ERROR("Kernel with name: '{}' already exists in OpenCL Program.", kernelName);
-			return;
+			return KernelHandle();
 		}
-		m_Kernels[kernelName] = new OpenCLKernel(this, kernelName, args);
+		return AddKernel(new OpenCLKernel(this, kernelName, args));
 	}
 
-	void OpenCLProgram::AddKernel(OpenCLKernel* kernel)
+	KernelHandle OpenCLProgram::AddKernel(OpenCLKernel* kernel)
 	{
-		if (OpenCLContext::GetShouldLogDebug() && m_Kernels.find(kernel->GetKernelName()) != m_Kernels.end())
+		auto inserted = m_KernelIndices.emplace(kernel->GetKernelName(), (uint32_t)m_Kernels.size());
+		if (!inserted.second)
 		{
 			LOG_ERROR("Kernel with name: '{}' already exists in OpenCL Program.", kernel->GetKernelName());
-			return;
+			return KernelHandle();
 		}
 
-		m_Kernels[kernel->GetKernelName()] = kernel;
+		m_Kernels.push_back(kernel);
+		return KernelHandle{ inserted.first->second };
+	}
+
+	KernelHandle OpenCLProgram::GetKernelHandle(const std::string& kernelName) const
+	{
+		auto index = m_KernelIndices.find(kernelName);
+		if (index == m_KernelIndices.end())
+		{
+			LOG_ERROR("No kernel with name: {} found.", kernelName);
+			return KernelHandle();
+		}
+		return KernelHandle{ index->second };
 	}
 
 	void OpenCLProgram::Execute(const std::string& kernelName, glm::ivec3& globalWorkSize, const glm::vec3& localWorkSize, uint32_t eventsInWaitListCount)
 	{
-		if (OpenCLContext::GetShouldLogDebug() && m_Kernels.find(kernelName) == m_Kernels.end())
+		Execute(GetKernelHandle(kernelName), globalWorkSize, glm::ivec3(localWorkSize));
+	}
+
+	void OpenCLProgram::Execute(KernelHandle kernel, const glm::ivec3& globalWorkSize, const glm::ivec3& localWorkSize)
+	{
+		OpenCLKernel* resolved = GetKernel(kernel);
+		if (resolved == nullptr)
+		{
+			LOG_ERROR("Unable to Execute CLProgram.  Invalid kernel handle.");
+			return;
+		}
+
+		EnqueueKernel(resolved, globalWorkSize, localWorkSize);
+	}
+
+	void OpenCLProgram::ExecuteOnDevice(uint32_t device, const std::string& kernelName, const glm::ivec3& globalWorkSize, const glm::ivec3& localWorkSize, size_t globalOffset, const std::vector<cl_event>& waitList, cl_event* completion)
+	{
+		ExecuteOnDevice(device, GetKernelHandle(kernelName), globalWorkSize, localWorkSize, globalOffset, waitList, completion);
+	}
+
+	void OpenCLProgram::ExecuteOnDevice(uint32_t device, KernelHandle kernel, const glm::ivec3& globalWorkSize, const glm::ivec3& localWorkSize, size_t globalOffset, const std::vector<cl_event>& waitList, cl_event* completion)
+	{
+		OpenCLKernel* resolved = GetKernel(kernel);
+		if (resolved == nullptr || device >= m_CommandQueues.size())
 		{
-			LOG_ERROR("Unable to Execute CLProgram.  No kernel with name: {} found.", kernelName);
+			LOG_ERROR("Unable to Execute CLProgram.  Invalid kernel handle or no device {} found.", device);
 			return;
 		}
 
-		OpenCLKernel* kernel = m_Kernels[kernelName];
+		EnqueueKernel(resolved, globalWorkSize, localWorkSize, device, globalOffset, waitList, completion);
+	}
+
+	void OpenCLProgram::EnqueueKernel(OpenCLKernel* kernel, const glm::ivec3& globalWorkSize, const glm::ivec3& localWorkSize, uint32_t device, size_t globalOffset, const std::vector<cl_event>& waitList, cl_event* completion)
+	{
 		kernel->AttachArgs();
 		const size_t globalWorkSizes[3] = { globalWorkSize.x, globalWorkSize.y, globalWorkSize.z };
 		const size_t lobalWorkSizes[3] = { localWorkSize.x, localWorkSize.y, localWorkSize.z };
+		const size_t globalOffsets[3] = { globalOffset, 0, 0 };
 
-		std::chrono::duration<double> elapsed;
-		auto start = std::chrono::high_resolution_clock::now();
-		cl_event wait;
-		cl_int status = clEnqueueNDRangeKernel(m_CommandQueue, kernel->GetID(), 1, NULL, globalWorkSizes, lobalWorkSizes, 0, NULL, &wait);
-		auto end = std::chrono::high_resolution_clock::now();
-		elapsed = end - start;
+		cl_event event = nullptr;
+		cl_int status = clEnqueueNDRangeKernel(m_CommandQueues[device], kernel->GetID(), 1, globalOffset != 0 ? globalOffsets : NULL, globalWorkSizes, lobalWorkSizes,
+			(cl_uint)waitList.size(), waitList.empty() ? NULL : waitList.data(), &event);
+		OpenCLContext::PrintCLError(status, "clEnqueueNDRangeKernel failed");
 
-		m_SumTimeMS += elapsed.count();
+		if (completion != nullptr)
+		{
+			clRetainEvent(event);
+			*completion = event;
+		}
+
+		// Each device's share is profiled on its own so the split shows up in the report.
+		size_t workItems = globalWorkSizes[0] * globalWorkSizes[1] * globalWorkSizes[2];
+		m_Profiler.Record(kernel->GetProfileStats(device), CLCommandType::Kernel, event, workItems * kernel->GetBytesPerWorkItem());
 	}
 
-	OpenCLBuffer* OpenCLProgram::GetBuffer(const std::string& bufferName)
+	BufferHandle OpenCLProgram::GetBufferHandle(const std::string& bufferName) const
 	{
-		if (m_Buffers.find(bufferName) == m_Buffers.end())
+		auto index = m_BufferIndices.find(bufferName);
+		if (index == m_BufferIndices.end())
 		{
 			LOG_ERROR("Unable to retrieve buffer.  No buffer with name: {} found.", bufferName);
-			return nullptr;
+			return BufferHandle();
 		}
+		return BufferHandle{ index->second };
+	}
 
-		return m_Buffers[bufferName];
+	OpenCLBuffer* OpenCLProgram::GetBuffer(const std::string& bufferName)
+	{
+		return GetBuffer(GetBufferHandle(bufferName));
 	}
 
-	void OpenCLProgram::AddBuffer(const std::string& bufferName, size_t bufferSize, CLBufferType bufferType)
+	BufferHandle OpenCLProgram::AddBuffer(const std::string& bufferName, size_t bufferSize, CLBufferType bufferType)
 	{
-		if (m_Buffers.find(bufferName) != m_Buffers.end())
+		if (m_BufferIndices.find(bufferName) != m_BufferIndices.end())
 		{
 			LOG_ERROR("Buffer with name: '{}' already exists in OpenCL Program.", bufferName);
-			return;
+			return BufferHandle();
 		}
-		m_Buffers[bufferName] = new OpenCLBuffer(this, bufferName, bufferSize, bufferType);
+		return AddBuffer(new OpenCLBuffer(this, bufferName, bufferSize, bufferType));
 	}
 
-	void OpenCLProgram::AddBuffer(OpenCLBuffer* buffer)
+	BufferHandle OpenCLProgram::AddBuffer(OpenCLBuffer* buffer)
 	{
-		if (m_Buffers.find(buffer->GetBufferName()) != m_Buffers.end())
+		auto inserted = m_BufferIndices.emplace(buffer->GetBufferName(), (uint32_t)m_Buffers.size());
+		if (!inserted.second)
 		{
 			LOG_ERROR("Buffer with name: '{}' already exists in OpenCL Program.", buffer->GetBufferName());
-			return;
+			return BufferHandle();
 		}
 
-		m_Buffers[buffer->GetBufferName()] = buffer;
+		m_Buffers.push_back(buffer);
+		return BufferHandle{ inserted.first->second };
 	}
 
 	void OpenCLProgram::ReadDeviceBufferToHostBuffer(const std::string& bufferName, size_t hostBufferSize, void* destinationBuffer)
 	{
-		if (m_Buffers.find(bufferName) == m_Buffers.end())
+		ReadDeviceBufferToHostBuffer(GetBufferHandle(bufferName), hostBufferSize, destinationBuffer);
+	}
+
+	void OpenCLProgram::ReadDeviceBufferToHostBuffer(BufferHandle bufferHandle, size_t hostBufferSize, void* destinationBuffer)
+	{
+		OpenCLBuffer* buffer = GetBuffer(bufferHandle);
+		if (buffer == nullptr)
 		{
-			LOG_ERROR("Unable to Execute CLProgram.  No buffer with name: {} found.", bufferName);
+			LOG_ERROR("Unable to read device buffer to host.  Invalid buffer handle.");
 			return;
 		}
-
-		OpenCLBuffer* buffer = m_Buffers[bufferName];
+		const std::string& bufferName = buffer->GetBufferName();
 
 		if (buffer->GetType() == CLBufferType::WriteOnly)
 		{
@@ -157,65 +274,295 @@ namespace Engine
 			return;
 		}
 
-		cl_int status = clEnqueueReadBuffer(m_CommandQueue, buffer->GetBufferID(), CL_TRUE, 0, buffer->GetBufferSize(), destinationBuffer, 0, NULL, NULL);
+		if (buffer->IsHostVisible())
+		{
+			void* mapped = EnqueueMap(buffer, CL_MAP_READ, hostBufferSize);
+			if (mapped == nullptr)
+				return;
+			if (mapped != destinationBuffer)
+				memcpy(destinationBuffer, mapped, hostBufferSize);
+			EnqueueUnmap(buffer, mapped);
+			return;
+		}
+
+		cl_event event = nullptr;
+		cl_int status = clEnqueueReadBuffer(m_CommandQueue, buffer->GetBufferID(), CL_TRUE, 0, buffer->GetBufferSize(), destinationBuffer, 0, NULL, &event);
 		OpenCLContext::PrintCLError(status, "clEnqueueReadBuffer failed");
+		m_Profiler.Record(buffer->GetProfileStats(), CLCommandType::Read, event, buffer->GetBufferSize());
+	}
+
+	GLObjectSet OpenCLProgram::CreateGLObjectSet(const std::vector<BufferHandle>& buffers)
+	{
+		GLObjectSet set;
+		for (BufferHandle handle : buffers)
+		{
+			OpenCLBuffer* buffer = GetBuffer(handle);
+			if (buffer == nullptr || !buffer->IsAttachedToGLBuffer())
+			{
+				LOG_ERROR("Could not add {} to a GL object set because it is not associated with a GL buffer.", buffer ? buffer->GetBufferName() : "an invalid handle");
+				continue;
+			}
+
+			set.Buffers.push_back(buffer);
+			set.Label += set.Label.empty() ? buffer->GetBufferName() : "+" + buffer->GetBufferName();
+		}
+		set.Stats = m_Profiler.GetEntry(set.Label);
+		return set;
+	}
+
+	void OpenCLProgram::AcquireGLObjects(const GLObjectSet& set, const std::vector<cl_event>& waitList, cl_event* completion)
+	{
+		EnqueueGLObjects(true, set.Buffers, set.Stats, waitList, completion);
+	}
+
+	void OpenCLProgram::ReleaseGLObjects(const GLObjectSet& set, const std::vector<cl_event>& waitList, cl_event* completion)
+	{
+		EnqueueGLObjects(false, set.Buffers, set.Stats, waitList, completion);
 	}
 
-	void OpenCLProgram::EnqueueAcquireGLObjects(const std::string& deviceBufferName)
+	void OpenCLProgram::EnqueueAcquireGLObjects(const std::string& deviceBufferName, const std::vector<cl_event>& waitList, cl_event* completion)
 	{
-		OpenCLBuffer* deviceBuffer = GetBuffer(deviceBufferName);
+		EnqueueAcquireGLObjects(GetBufferHandle(deviceBufferName), waitList, completion);
+	}
+
+	void OpenCLProgram::EnqueueAcquireGLObjects(BufferHandle deviceBufferHandle, const std::vector<cl_event>& waitList, cl_event* completion)
+	{
+		OpenCLBuffer* deviceBuffer = GetBuffer(deviceBufferHandle);
 		if (deviceBuffer == nullptr)
 		{
-			LOG_ERROR("Could not EnqueueAquireGLObjects with device buffer named: {} - buffer not found", deviceBufferName);
+			LOG_ERROR("Could not EnqueueAquireGLObjects - invalid buffer handle.");
 			return;
 		}
 		if (!deviceBuffer->IsAttachedToGLBuffer())
 		{
-			LOG_ERROR("Could not EnqueueAquireGLObjects with device buffer named: {} because this buffer is not associated with a GL buffer.", deviceBufferName);
+			LOG_ERROR("Could not EnqueueAquireGLObjects with device buffer named: {} because this buffer is not associated with a GL buffer.", deviceBuffer->GetBufferName());
 			return;
 		}
 
-		cl_mem id = deviceBuffer->GetBufferID();
-		cl_int status = clEnqueueAcquireGLObjects(m_CommandQueue, 1, &id, 0, NULL, NULL);
-		OpenCLContext::PrintCLError(status, "clEnqueueAcquireGLObjects failed");
+		EnqueueGLObjects(true, { deviceBuffer }, deviceBuffer->GetProfileStats(), waitList, completion);
 	}
 
-	void OpenCLProgram::EnqueueReleaseGLObjects(const std::string& deviceBufferName)
+	void OpenCLProgram::EnqueueReleaseGLObjects(const std::string& deviceBufferName, const std::vector<cl_event>& waitList, cl_event* completion)
 	{
-		OpenCLBuffer* deviceBuffer = GetBuffer(deviceBufferName);
+		EnqueueReleaseGLObjects(GetBufferHandle(deviceBufferName), waitList, completion);
+	}
+
+	void OpenCLProgram::EnqueueReleaseGLObjects(BufferHandle deviceBufferHandle, const std::vector<cl_event>& waitList, cl_event* completion)
+	{
+		OpenCLBuffer* deviceBuffer = GetBuffer(deviceBufferHandle);
 		if (deviceBuffer == nullptr)
 		{
-			LOG_ERROR("Could not EnqueueReleaseGLObjects with device buffer named: {} - buffer not found.", deviceBufferName);
+			LOG_ERROR("Could not EnqueueReleaseGLObjects - invalid buffer handle.");
 			return;
 		}
 		if (!deviceBuffer->IsAttachedToGLBuffer())
 		{
-			LOG_ERROR("Could not EnqueueReleaseGLObjects with device buffer named: {} because this buffer is not associated with a GL buffer.", deviceBufferName);
+			LOG_ERROR("Could not EnqueueReleaseGLObjects with device buffer named: {} because this buffer is not associated with a GL buffer.", deviceBuffer->GetBufferName());
+			return;
+		}
+
+		EnqueueGLObjects(false, { deviceBuffer }, deviceBuffer->GetProfileStats(), waitList, completion);
+	}
+
+	void OpenCLProgram::EnqueueGLObjects(bool acquire, const std::vector<OpenCLBuffer*>& buffers, CLCommandStats* stats, const std::vector<cl_event>& waitList, cl_event* completion)
+	{
+		std::vector<cl_mem> objects;
+		for (OpenCLBuffer* buffer : buffers)
+		{
+			if (acquire)
+			{
+				if (buffer->m_AcquireCount++ == 0)
+					objects.push_back(buffer->GetBufferID());
+			}
+			else if (buffer->m_AcquireCount == 0)
+				LOG_ERROR("GL buffer {} is released without being acquired.", buffer->GetBufferName());
+			else if (--buffer->m_AcquireCount == 0)
+				objects.push_back(buffer->GetBufferID());
+		}
+
+		cl_event event = nullptr;
+		cl_uint waitCount = (cl_uint)waitList.size();
+		const cl_event* waitEvents = waitList.empty() ? NULL : waitList.data();
+		if (objects.empty())
+		{
+			// Everything is held elsewhere.  The queue is in-order, so a marker still gates what follows.
+			if (waitList.empty() && completion == nullptr)
+				return;
+
+			cl_int status = clEnqueueMarkerWithWaitList(m_CommandQueue, waitCount, waitEvents, &event);
+			OpenCLContext::PrintCLError(status, "clEnqueueMarkerWithWaitList failed");
+			if (completion != nullptr)
+				*completion = event;
+			else
+				clReleaseEvent(event);
 			return;
 		}
 
-		cl_mem id = deviceBuffer->GetBufferID();
-		cl_int status = clEnqueueReleaseGLObjects(m_CommandQueue, 1, &id, 0, NULL, NULL);
-		OpenCLContext::PrintCLError(status, "clEnqueueReleaseGLObjects failed");
+		cl_int status;
+		if (acquire)
+		{
+			status = clEnqueueAcquireGLObjects(m_CommandQueue, (cl_uint)objects.size(), objects.data(), waitCount, waitEvents, &event);
+			OpenCLContext::PrintCLError(status, "clEnqueueAcquireGLObjects failed");
+		}
+		else
+		{
+			status = clEnqueueReleaseGLObjects(m_CommandQueue, (cl_uint)objects.size(), objects.data(), waitCount, waitEvents, &event);
+			OpenCLContext::PrintCLError(status, "clEnqueueReleaseGLObjects failed");
+		}
+
+		if (completion != nullptr)
+		{
+			clRetainEvent(event);
+			*completion = event;
+		}
+		m_Profiler.Record(stats, acquire ? CLCommandType::Acquire : CLCommandType::Release, event, 0);
+	}
+
+	void OpenCLProgram::Submit()
+	{
+		for (cl_command_queue queue : m_CommandQueues)
+			clFlush(queue);
+		m_Profiler.Resolve();
 	}
 
 	void OpenCLProgram::Flush()
 	{
-		clFinish(m_CommandQueue);
+		for (cl_command_queue queue : m_CommandQueues)
+			clFinish(queue);
+		m_Profiler.Resolve();
 	}
 
 	void OpenCLProgram::WriteToDeviceBufferFromHostBuffer(const std::string& deviceBufferName, size_t hostBufferSize, void* hostBuffer)
 	{
-		if (m_Buffers.find(deviceBufferName) == m_Buffers.end())
+		WriteToDeviceBufferFromHostBuffer(GetBufferHandle(deviceBufferName), hostBufferSize, hostBuffer);
+	}
+
+	void OpenCLProgram::WriteToDeviceBufferFromHostBuffer(BufferHandle deviceBuffer, size_t hostBufferSize, void* hostBuffer)
+	{
+		OpenCLBuffer* buffer = GetBuffer(deviceBuffer);
+		if (buffer == nullptr)
 		{
-			LOG_ERROR("Unable to write to device buffer from host.  No buffer with name: {} found.", deviceBufferName);
+			LOG_ERROR("Unable to write to device buffer from host.  Invalid buffer handle.");
 			return;
 		}
 
-		OpenCLBuffer* buffer = m_Buffers[deviceBufferName];
+		EnqueueWrite(buffer, hostBufferSize, hostBuffer);
+	}
+
+	void OpenCLProgram::EnqueueWrite(OpenCLBuffer* buffer, size_t hostBufferSize, const void* hostBuffer)
+	{
+		if (hostBuffer != nullptr && hostBuffer == buffer->GetHostMemory())
+		{
+			// The data is already where the buffer lives, so the map and unmap only hand it to the
+			// device.  Neither blocks: the unmap waits on the map, and later commands on the unmap.
+			cl_event mapEvent = nullptr;
+			void* mapped = EnqueueMap(buffer, CL_MAP_WRITE_INVALIDATE_REGION, hostBufferSize, false, &mapEvent);
+			if (mapped == nullptr)
+				return;
+			EnqueueUnmap(buffer, mapped, { mapEvent });
+			clReleaseEvent(mapEvent);
+			return;
+		}
 
-		cl_int status = clEnqueueWriteBuffer(m_CommandQueue, buffer->GetBufferID(), CL_FALSE, 0, hostBufferSize, hostBuffer, 0, NULL, NULL);
+		// Host-visible buffers take the same path: the driver copies straight into their host-resident
+		// memory without the queue having to drain first, as a blocking map would.
+		cl_event event = nullptr;
+		cl_int status = clEnqueueWriteBuffer(m_CommandQueue, buffer->GetBufferID(), CL_FALSE, 0, hostBufferSize, hostBuffer, 0, NULL, &event);
 		if (status != CL_SUCCESS)
 			LOG_ERROR("clEnqueueWriteBuffer failed (1)");
+		m_Profiler.Record(buffer->GetProfileStats(), CLCommandType::Write, event, hostBufferSize);
+	}
+
+	void* OpenCLProgram::MapBuffer(const std::string& bufferName, bool write)
+	{
+		return MapBuffer(GetBufferHandle(bufferName), write);
+	}
+
+	void* OpenCLProgram::MapBuffer(BufferHandle bufferHandle, bool write)
+	{
+		OpenCLBuffer* buffer = GetBuffer(bufferHandle);
+		if (buffer == nullptr)
+			return nullptr;
+
+		return EnqueueMap(buffer, write ? CL_MAP_WRITE_INVALIDATE_REGION : CL_MAP_READ, buffer->GetBufferSize());
+	}
+
+	void OpenCLProgram::UnmapBuffer(const std::string& bufferName, void* mapped)
+	{
+		UnmapBuffer(GetBufferHandle(bufferName), mapped);
+	}
+
+	void OpenCLProgram::UnmapBuffer(BufferHandle bufferHandle, void* mapped)
+	{
+		OpenCLBuffer* buffer = GetBuffer(bufferHandle);
+		if (buffer == nullptr)
+			return;
+
+		EnqueueUnmap(buffer, mapped);
+	}
+
+	void* OpenCLProgram::EnqueueMap(OpenCLBuffer* buffer, cl_map_flags flags, size_t size, bool blocking, cl_event* completion)
+	{
+		// Device buffers map too, but through a driver copy each way; only host-visible ones are free.
+		// A read map is profiled here, where the data reaches the host; a write map at its unmap.
+		cl_event event = nullptr;
+		cl_int status;
+		void* mapped = clEnqueueMapBuffer(m_CommandQueue, buffer->GetBufferID(), blocking ? CL_TRUE : CL_FALSE, flags, 0, size, 0, NULL, &event, &status);
+		OpenCLContext::PrintCLError(status, "clEnqueueMapBuffer failed");
+		if (status != CL_SUCCESS)
+			return nullptr;
+
+		if (completion != nullptr)
+		{
+			clRetainEvent(event);
+			*completion = event;
+		}
+		if (flags & CL_MAP_READ)
+			m_Profiler.Record(buffer->GetProfileStats(), CLCommandType::Read, event, size);
+		else
+			clReleaseEvent(event);
+
+		buffer->m_MapFlags = flags;
+		buffer->m_MappedBytes = size;
+		return mapped;
+	}
+
+	void OpenCLProgram::EnqueueUnmap(OpenCLBuffer* buffer, void* mapped, const std::vector<cl_event>& waitList)
+	{
+		cl_event event = nullptr;
+		cl_int status = clEnqueueUnmapMemObject(m_CommandQueue, buffer->GetBufferID(), mapped,
+			(cl_uint)waitList.size(), waitList.empty() ? NULL : waitList.data(), &event);
+		OpenCLContext::PrintCLError(status, "clEnqueueUnmapMemObject failed");
+
+		// Only a write map has anything to hand back to the device.
+		if (buffer->m_MapFlags & (CL_MAP_WRITE | CL_MAP_WRITE_INVALIDATE_REGION))
+			m_Profiler.Record(buffer->GetProfileStats(), CLCommandType::Write, event, buffer->m_MappedBytes);
+		else if (event != nullptr)
+			clReleaseEvent(event);
+		buffer->m_MapFlags = 0;
+	}
+
+	void OpenCLProgram::CopyDeviceBuffer(const std::string& sourceBufferName, const std::string& destinationBufferName)
+	{
+		CopyDeviceBuffer(GetBufferHandle(sourceBufferName), GetBufferHandle(destinationBufferName));
+	}
+
+	void OpenCLProgram::CopyDeviceBuffer(BufferHandle sourceBuffer, BufferHandle destinationBuffer)
+	{
+		OpenCLBuffer* source = GetBuffer(sourceBuffer);
+		OpenCLBuffer* destination = GetBuffer(destinationBuffer);
+		if (source == nullptr || destination == nullptr)
+			return;
+
+		if (source->GetBufferSize() != destination->GetBufferSize())
+		{
+			LOG_ERROR("Failed to copy device buffer {} to {}.  Sizes differ: {} and {}.", source->GetBufferName(), destination->GetBufferName(), source->GetBufferSize(), destination->GetBufferSize());
+			return;
+		}
+
+		cl_event event = nullptr;
+		cl_int status = clEnqueueCopyBuffer(m_CommandQueue, source->GetBufferID(), destination->GetBufferID(), 0, 0, source->GetBufferSize(), 0, NULL, &event);
+		OpenCLContext::PrintCLError(status, "clEnqueueCopyBuffer failed");
+		m_Profiler.Record(destination->GetProfileStats(), CLCommandType::Copy, event, source->GetBufferSize() * 2);
 	}
 }
\ No newline at end of file
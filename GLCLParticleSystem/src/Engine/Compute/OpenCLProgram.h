@@ -4,43 +4,152 @@
 #include <OpenCL/cl_platform.h>
 #include "Engine/Compute/OpenCLKernel.h"
 #include "Engine/Compute/OpenCLBuffer.h"
+#include "Engine/Compute/OpenCLProfiler.h"
 
 namespace Engine
 {
 	enum class BufferType { Read, Write };
 
+	// Index of a kernel or buffer in its program, resolved once at setup so per-frame calls
+	// skip the name lookup.  Tag keeps kernel and buffer handles from being mixed up.
+	template<typename Tag>
+	struct ProgramHandle
+	{
+		static constexpr uint32_t Invalid = ~0u;
+		uint32_t Index = Invalid;
+
+		bool IsValid() const { return Index != Invalid; }
+	};
+
+	using KernelHandle = ProgramHandle<OpenCLKernel>;
+	using BufferHandle = ProgramHandle<OpenCLBuffer>;
+
+	// GL-shared buffers that are acquired and released together.  See OpenCLProgram::AcquireGLObjects().
+	struct GLObjectSet
+	{
+		std::vector<OpenCLBuffer*> Buffers;
+		// Names the interop calls in the profiler, and their entry there.
+		std::string Label;
+		CLCommandStats* Stats = nullptr;
+	};
+
 	class OpenCLProgram
 	{
 	public:
-		OpenCLProgram(const std::string& kernelFilePath);
+		// buildOptions are passed to clBuildProgram, typically -D definitions and math flags that
+		// specialize the source.  Each distinct option set is a separate variant; variants are
+		// built once per process and shared by every program compiled from the same source.
+		OpenCLProgram(const std::string& kernelFilePath, const std::string& buildOptions = "");
 		~OpenCLProgram();
 
-		void AddKernel(const std::string& kernelName, const std::initializer_list<KernelArg*>& args);
-		void AddKernel(OpenCLKernel* kernel);
-		void AddBuffer(const std::string& bufferName, size_t bufferSize, CLBufferType bufferType);
-		void AddBuffer(OpenCLBuffer* buffer);
+		// The program takes ownership.  A name already in use returns an invalid handle.
+		KernelHandle AddKernel(const std::string& kernelName, const std::initializer_list<KernelArg*>& args);
+		KernelHandle AddKernel(OpenCLKernel* kernel);
+		BufferHandle AddBuffer(const std::string& bufferName, size_t bufferSize, CLBufferType bufferType);
+		BufferHandle AddBuffer(OpenCLBuffer* buffer);
+
+		// Name lookups, for setup.  Every call below that takes a name has a handle overload,
+		// which is what per-frame code should use.
+		KernelHandle GetKernelHandle(const std::string& kernelName) const;
+		BufferHandle GetBufferHandle(const std::string& bufferName) const;
+		OpenCLKernel* GetKernel(KernelHandle kernel) const { return kernel.Index < m_Kernels.size() ? m_Kernels[kernel.Index] : nullptr; }
+		OpenCLBuffer* GetBuffer(BufferHandle buffer) const { return buffer.Index < m_Buffers.size() ? m_Buffers[buffer.Index] : nullptr; }
+		OpenCLBuffer* GetBuffer(const std::string& bufferName);
+
 		void ReadDeviceBufferToHostBuffer(const std::string& bufferName, size_t hostBufferSize, void* destinationBuffer);
-		void EnqueueAcquireGLObjects(const std::string& deviceBufferName);
-		void EnqueueReleaseGLObjects(const std::string& deviceBufferName);
+		void ReadDeviceBufferToHostBuffer(BufferHandle buffer, size_t hostBufferSize, void* destinationBuffer);
+		// Builds a set from GL-shared buffers.  Anything else is reported and left out.
+		GLObjectSet CreateGLObjectSet(const std::vector<BufferHandle>& buffers);
+		// Acquires or releases the whole set in one interop call.  Acquires are counted per buffer:
+		// a buffer CL already holds is not acquired again, and only the release matching its first
+		// acquire hands it back to GL, so nested users of the same buffers cost no interop calls.
+		// When nothing is left to enqueue a marker stands in for waitList and completion.
+		void AcquireGLObjects(const GLObjectSet& set, const std::vector<cl_event>& waitList = {}, cl_event* completion = nullptr);
+		void ReleaseGLObjects(const GLObjectSet& set, const std::vector<cl_event>& waitList = {}, cl_event* completion = nullptr);
+		// Single-buffer forms of the above, counted the same way.
+		// waitList events gate the command; completion, when given, receives a retained event
+		// the caller must release.
+		void EnqueueAcquireGLObjects(const std::string& deviceBufferName, const std::vector<cl_event>& waitList = {}, cl_event* completion = nullptr);
+		void EnqueueAcquireGLObjects(BufferHandle deviceBuffer, const std::vector<cl_event>& waitList = {}, cl_event* completion = nullptr);
+		void EnqueueReleaseGLObjects(const std::string& deviceBufferName, const std::vector<cl_event>& waitList = {}, cl_event* completion = nullptr);
+		void EnqueueReleaseGLObjects(BufferHandle deviceBuffer, const std::vector<cl_event>& waitList = {}, cl_event* completion = nullptr);
+		// Submits everything enqueued so far, on every device, without waiting for it.
+		void Submit();
+		// Blocks until every device's queue is empty.
 		void Flush();
 
+		// Uploads never block.  Reading back from host-visible buffers maps rather than copies, and
+		// uploading from or reading back into the memory a buffer wraps skips the copy altogether.
+		// See OpenCLBuffer.
 		void WriteToDeviceBufferFromHostBuffer(const std::string& deviceBufferName, size_t hostBufferSize, void* hostBuffer);
+		void WriteToDeviceBufferFromHostBuffer(BufferHandle deviceBuffer, size_t hostBufferSize, void* hostBuffer);
+		void CopyDeviceBuffer(const std::string& sourceBufferName, const std::string& destinationBufferName);
+		void CopyDeviceBuffer(BufferHandle sourceBuffer, BufferHandle destinationBuffer);
 
-		void Execute(const std::string& kernelName, glm::ivec3& globalWorkSize, const glm::vec3& localWorkSize, uint32_t eventsInWaitListCount);
+		// Blocks until everything enqueued before has finished with the buffer, then returns a host
+		// pointer to its contents.  write discards them, so only what the host writes reaches the
+		// device; otherwise the mapping is read-only.  Kernels must not use the buffer until UnmapBuffer().
+		void* MapBuffer(const std::string& bufferName, bool write);
+		void* MapBuffer(BufferHandle buffer, bool write);
+		void UnmapBuffer(const std::string& bufferName, void* mapped);
+		void UnmapBuffer(BufferHandle buffer, void* mapped);
 
-		OpenCLBuffer* GetBuffer(const std::string& bufferName);
+		void Execute(const std::string& kernelName, glm::ivec3& globalWorkSize, const glm::vec3& localWorkSize, uint32_t eventsInWaitListCount);
+		void Execute(KernelHandle kernel, const glm::ivec3& globalWorkSize, const glm::ivec3& localWorkSize);
+		// Runs the kernel on one device of the context, over [globalOffset, globalOffset + globalWorkSize).
+		// Queues of different devices don't order against each other; use waitList and completion.
+		void ExecuteOnDevice(uint32_t device, const std::string& kernelName, const glm::ivec3& globalWorkSize, const glm::ivec3& localWorkSize,
+			size_t globalOffset, const std::vector<cl_event>& waitList = {}, cl_event* completion = nullptr);
+		void ExecuteOnDevice(uint32_t device, KernelHandle kernel, const glm::ivec3& globalWorkSize, const glm::ivec3& localWorkSize,
+			size_t globalOffset, const std::vector<cl_event>& waitList = {}, cl_event* completion = nullptr);
 
 		cl_command_queue GetCommandQueueID() const { return m_CommandQueue; }
+		// One queue per device in OpenCLContext::GetDevices(), in the same order.
+		uint32_t GetDeviceCount() const { return (uint32_t)m_CommandQueues.size(); }
 
 		cl_program GetID() const { return m_ID; }
+		const std::string& GetBuildOptions() const { return m_BuildOptions; }
+		// Identifies the source, build options and devices; see OpenCLBinaryCache::ComputeKey().
+		uint64_t GetCacheKey() const { return m_CacheKey; }
+
+		// Drops the process-wide variant cache.  Programs already created keep their variant.
+		static void ReleaseVariants();
 
-		double GetSumTime() const { return m_SumTimeMS; }
+		// Device time spent in kernels, in seconds, as of the last Submit() or Flush().
+		double GetSumTime() const { return m_Profiler.GetKernelTime(); }
+		OpenCLProfiler& GetProfiler() { return m_Profiler; }
 
 	private:
-		double m_SumTimeMS = 0.0;
-		std::unordered_map<std::string, OpenCLKernel*> m_Kernels;
-		std::unordered_map<std::string, OpenCLBuffer*> m_Buffers;
+		bool BuildFromSource(const char* source, const std::string& options, uint64_t cacheKey);
+
+		// Resolved paths behind the name and handle calls, also used directly by OpenCLGraph.
+		void EnqueueKernel(OpenCLKernel* kernel, const glm::ivec3& globalWorkSize, const glm::ivec3& localWorkSize,
+			uint32_t device = 0, size_t globalOffset = 0, const std::vector<cl_event>& waitList = {}, cl_event* completion = nullptr);
+		void EnqueueWrite(OpenCLBuffer* buffer, size_t hostBufferSize, const void* hostBuffer);
+		// completion, when given, receives a retained event for the map the caller must release.
+		void* EnqueueMap(OpenCLBuffer* buffer, cl_map_flags flags, size_t size, bool blocking = true, cl_event* completion = nullptr);
+		// Profiled as the write or read the matching EnqueueMap() was.
+		void EnqueueUnmap(OpenCLBuffer* buffer, void* mapped, const std::vector<cl_event>& waitList = {});
+		// Acquires or releases, in one call, those buffers whose acquire count leaves or reaches
+		// zero.  label names the command in the profiler.
+		void EnqueueGLObjects(bool acquire, const std::vector<OpenCLBuffer*>& buffers, CLCommandStats* stats, const std::vector<cl_event>& waitList, cl_event* completion);
+
+		friend class OpenCLGraph;
+
+	private:
+		OpenCLProfiler m_Profiler;
+		// Indexed by handle, in the order they were added.
+		std::vector<OpenCLKernel*> m_Kernels;
+		std::vector<OpenCLBuffer*> m_Buffers;
+		std::unordered_map<std::string, uint32_t> m_KernelIndices;
+		std::unordered_map<std::string, uint32_t> m_BufferIndices;
+		std::vector<cl_command_queue> m_CommandQueues;
 		cl_command_queue m_CommandQueue;
 		cl_program m_ID;
+		std::string m_BuildOptions;
+		uint64_t m_CacheKey = 0;
+
+		// Built programs by source, options and device.  Each holds one reference of its own.
+		static std::unordered_map<uint64_t, cl_program> s_Variants;
 	};
 }
\ No newline at end of file
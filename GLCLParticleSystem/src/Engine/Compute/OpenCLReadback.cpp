@@ -0,0 +1,189 @@
+#include "glclpch.h"
+#include "Engine/Compute/OpenCLReadback.h"
+#include "Engine/Compute/OpenCLContext.h"
+
+namespace Engine
+{
+	OpenCLReadback::OpenCLReadback(OpenCLProgram* program, size_t chunkBytes, uint32_t slotCount)
+		:m_Program(program), m_ChunkBytes(chunkBytes), m_Slots(std::max<uint32_t>(slotCount, 1))
+	{
+		// A queue of its own lets the chunk reads overlap the simulation on devices with copy engines.
+		cl_int status;
+		m_Queue = clCreateCommandQueue(OpenCLContext::GetContext(), OpenCLContext::GetDevice(), 0, &status);
+		OpenCLContext::PrintCLError(status, "clCreateCommandQueue failed (readback)");
+
+		// Host-allocated and mapped once, so every chunk lands in pinned memory.
+		for (StagingSlot& slot : m_Slots)
+		{
+			slot.Buffer = clCreateBuffer(OpenCLContext::GetContext(), CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, m_ChunkBytes, NULL, &status);
+			OpenCLContext::PrintCLError(status, "clCreateBuffer failed (readback staging)");
+			slot.Mapped = clEnqueueMapBuffer(m_Queue, slot.Buffer, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, m_ChunkBytes, 0, NULL, NULL, &status);
+			OpenCLContext::PrintCLError(status, "clEnqueueMapBuffer failed (readback staging)");
+		}
+	}
+
+	OpenCLReadback::~OpenCLReadback()
+	{
+		clFinish(m_Queue);
+
+		for (StagingSlot& slot : m_Slots)
+		{
+			if (slot.Ready != nullptr)
+				clReleaseEvent(slot.Ready);
+			clEnqueueUnmapMemObject(m_Queue, slot.Buffer, slot.Mapped, 0, NULL, NULL);
+		}
+		clFinish(m_Queue);
+
+		for (StagingSlot& slot : m_Slots)
+			clReleaseMemObject(slot.Buffer);
+		for (PendingRead* request : m_Requests)
+			Release(request);
+
+		clReleaseCommandQueue(m_Queue);
+	}
+
+	uint64_t OpenCLReadback::Request(OpenCLBuffer* buffer, size_t elementSize, const ReadbackRange& range, const Callback& callback, const std::vector<cl_event>& waitList,
+		cl_event* snapshotCopied)
+	{
+		size_t elementCount = elementSize > 0 ? buffer->GetBufferSize() / elementSize : 0;
+		size_t stride = std::max<size_t>(range.Stride, 1);
+		size_t count = range.Count > 0 ? range.Count : (range.First < elementCount ? (elementCount - range.First + stride - 1) / stride : 0);
+		if (elementSize == 0 || elementSize > m_ChunkBytes || count == 0 || range.First + (count - 1) * stride >= elementCount)
+		{
+			LOG_ERROR("Readback of {} out of range: {} elements of {} bytes from {}, stride {}.", buffer->GetBufferName(), count, elementSize, range.First, stride);
+			return 0;
+		}
+
+		PendingRead* request = new PendingRead();
+		request->ID = m_NextID++;
+		request->ElementSize = elementSize;
+		request->Size = count * elementSize;
+		request->OnChunk = callback;
+
+		cl_int status;
+		request->Snapshot = clCreateBuffer(OpenCLContext::GetContext(), CL_MEM_READ_WRITE, request->Size, NULL, &status);
+		OpenCLContext::PrintCLError(status, "clCreateBuffer failed (readback snapshot)");
+		if (status != CL_SUCCESS)
+		{
+			delete request;
+			return 0;
+		}
+
+		// The copy packs the selection, so the reads below are always contiguous.
+		cl_command_queue queue = m_Program->GetCommandQueueID();
+		cl_uint waitCount = (cl_uint)waitList.size();
+		const cl_event* waitEvents = waitList.empty() ? NULL : waitList.data();
+		if (stride == 1)
+		{
+			status = clEnqueueCopyBuffer(queue, buffer->GetBufferID(), request->Snapshot, range.First * elementSize, 0, request->Size, waitCount, waitEvents, &request->SnapshotReady);
+		}
+		else
+		{
+			const size_t sourceOrigin[3] = { range.First * elementSize, 0, 0 };
+			const size_t destinationOrigin[3] = { 0, 0, 0 };
+			const size_t region[3] = { elementSize, count, 1 };
+			status = clEnqueueCopyBufferRect(queue, buffer->GetBufferID(), request->Snapshot, sourceOrigin, destinationOrigin, region,
+				stride * elementSize, 0, elementSize, 0, waitCount, waitEvents, &request->SnapshotReady);
+		}
+		OpenCLContext::PrintCLError(status, "Readback snapshot copy failed");
+		if (status != CL_SUCCESS)
+		{
+			request->SnapshotReady = nullptr;
+			Release(request);
+			return 0;
+		}
+		clFlush(queue);
+
+		if (snapshotCopied != nullptr)
+		{
+			clRetainEvent(request->SnapshotReady);
+			*snapshotCopied = request->SnapshotReady;
+		}
+
+		m_Requests.push_back(request);
+		Issue();
+		return request->ID;
+	}
+
+	void OpenCLReadback::Issue()
+	{
+		for (uint32_t i = 0; i < (uint32_t)m_Slots.size(); i++)
+		{
+			StagingSlot& slot = m_Slots[i];
+			if (slot.Owner != nullptr)
+				continue;
+
+			auto pending = std::find_if(m_Requests.begin(), m_Requests.end(), [](const PendingRead* request) { return request->Issued < request->Size; });
+			if (pending == m_Requests.end())
+				break;
+
+			// Chunks hold whole elements, so each callback gets complete ones.
+			PendingRead* request = *pending;
+			size_t chunkBytes = m_ChunkBytes / request->ElementSize * request->ElementSize;
+			slot.Owner = request;
+			slot.Offset = request->Issued;
+			slot.Size = std::min(chunkBytes, request->Size - request->Issued);
+			request->Issued += slot.Size;
+
+			cl_int status = clEnqueueReadBuffer(m_Queue, request->Snapshot, CL_FALSE, slot.Offset, slot.Size, slot.Mapped, 1, &request->SnapshotReady, &slot.Ready);
+			OpenCLContext::PrintCLError(status, "clEnqueueReadBuffer failed (readback)");
+			m_InFlight.push_back(i);
+		}
+
+		clFlush(m_Queue);
+	}
+
+	void OpenCLReadback::Poll()
+	{
+		while (!m_InFlight.empty())
+		{
+			StagingSlot& slot = m_Slots[m_InFlight.front()];
+
+			cl_int executionStatus = CL_QUEUED;
+			clGetEventInfo(slot.Ready, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(executionStatus), &executionStatus, NULL);
+			if (executionStatus > CL_COMPLETE)
+				break;
+			if (executionStatus < 0)
+				LOG_ERROR("Readback chunk failed with status {}.", executionStatus);
+
+			PendingRead* request = slot.Owner;
+			request->Delivered += slot.Size;
+			bool last = request->Delivered == request->Size;
+
+			ReadbackChunk chunk = { request->ID, slot.Mapped, slot.Offset / request->ElementSize, slot.Size / request->ElementSize, last };
+			if (executionStatus == CL_COMPLETE && request->OnChunk)
+				request->OnChunk(chunk);
+
+			clReleaseEvent(slot.Ready);
+			slot.Ready = nullptr;
+			slot.Owner = nullptr;
+			m_InFlight.pop_front();
+
+			if (last)
+			{
+				m_Requests.erase(std::find(m_Requests.begin(), m_Requests.end(), request));
+				Release(request);
+			}
+		}
+
+		Issue();
+	}
+
+	void OpenCLReadback::Drain()
+	{
+		while (!IsIdle())
+		{
+			if (!m_InFlight.empty())
+				clWaitForEvents(1, &m_Slots[m_InFlight.front()].Ready);
+			Poll();
+		}
+	}
+
+	void OpenCLReadback::Release(PendingRead* request)
+	{
+		if (request->SnapshotReady != nullptr)
+			clReleaseEvent(request->SnapshotReady);
+		clReleaseMemObject(request->Snapshot);
+		delete request;
+	}
+}
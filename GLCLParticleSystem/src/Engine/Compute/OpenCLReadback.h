@@ -0,0 +1,99 @@
+#pragma once
+
+#include <OpenCL/cl.h>
+#include "Engine/Compute/OpenCLProgram.h"
+
+#include <deque>
+#include <functional>
+
+namespace Engine
+{
+	// Which elements of a buffer to read: Count of them starting at First, Stride apart.
+	// A Count of 0 reads to the end of the buffer.
+	struct ReadbackRange
+	{
+		size_t First = 0;
+		size_t Count = 0;
+		size_t Stride = 1;
+	};
+
+	// One piece of a readback.  Data holds ElementCount packed elements, the ones at positions
+	// [FirstElement, FirstElement + ElementCount) of the request's range, and is only valid
+	// during the callback.
+	struct ReadbackChunk
+	{
+		uint64_t Request;
+		const void* Data;
+		size_t FirstElement;
+		size_t ElementCount;
+		bool Last;
+	};
+
+	// Streams buffer contents back to the host without stalling the program's queue.
+	// Request() snapshots the selected elements into a packed device buffer, ordered on the
+	// program's queue after everything enqueued so far, and returns at once.  The snapshot is
+	// then read on a queue of its own, in chunks, through a ring of pinned staging buffers, and
+	// each chunk is handed to the request's callback, in order, from Poll().  Kernels can go on
+	// writing the source buffer as soon as the snapshot copy has run.
+	class OpenCLReadback
+	{
+	public:
+		using Callback = std::function<void(const ReadbackChunk&)>;
+
+		// The ring holds slotCount staging buffers of chunkBytes each.
+		OpenCLReadback(OpenCLProgram* program, size_t chunkBytes = 4 * 1024 * 1024, uint32_t slotCount = 4);
+		// Waits for and drops anything still in flight without calling back.
+		~OpenCLReadback();
+
+		// elementSize is the size of one element in bytes.  buffer must be usable on the program's
+		// queue, i.e. acquired if it is GL-shared, and waitList may name work on other queues the
+		// snapshot must follow.  snapshotCopied, when given, receives a retained event for the
+		// snapshot copy, which writers of buffer on other queues have to wait for.  Returns 0 if
+		// the range doesn't fit the buffer.
+		uint64_t Request(OpenCLBuffer* buffer, size_t elementSize, const ReadbackRange& range, const Callback& callback, const std::vector<cl_event>& waitList = {},
+			cl_event* snapshotCopied = nullptr);
+
+		// Calls back every chunk that has arrived and puts free staging buffers to work.  Never blocks.
+		void Poll();
+		// Polls until every request has been called back in full.
+		void Drain();
+		bool IsIdle() const { return m_Requests.empty(); }
+
+	private:
+		struct PendingRead
+		{
+			uint64_t ID;
+			cl_mem Snapshot = nullptr;
+			cl_event SnapshotReady = nullptr;
+			size_t ElementSize;
+			size_t Size;
+			// Bytes handed to staging buffers and bytes called back.
+			size_t Issued = 0;
+			size_t Delivered = 0;
+			Callback OnChunk;
+		};
+
+		struct StagingSlot
+		{
+			cl_mem Buffer = nullptr;
+			void* Mapped = nullptr;
+			cl_event Ready = nullptr;
+			PendingRead* Owner = nullptr;
+			size_t Offset = 0;
+			size_t Size = 0;
+		};
+
+		void Issue();
+		void Release(PendingRead* request);
+
+	private:
+		OpenCLProgram* m_Program;
+		cl_command_queue m_Queue;
+		size_t m_ChunkBytes;
+		uint64_t m_NextID = 1;
+		std::vector<StagingSlot> m_Slots;
+		// Slots in the order they were issued, which is the order they complete in.
+		std::deque<uint32_t> m_InFlight;
+		std::deque<PendingRead*> m_Requests;
+	};
+}
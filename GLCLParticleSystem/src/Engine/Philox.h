@@ -0,0 +1,54 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace Engine
+{
+	// Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3").
+	// Counter-based: every (counter, key) pair maps to four independent 32-bit outputs with no
+	// state, so any thread can draw any particle's numbers in any order.  particle_sim.cl holds
+	// the device twin; both produce the same bits for the same inputs.
+	namespace Philox
+	{
+		constexpr uint32_t c_M0 = 0xD2511F53u;
+		constexpr uint32_t c_M1 = 0xCD9E8D57u;
+		constexpr uint32_t c_W0 = 0x9E3779B9u;
+		constexpr uint32_t c_W1 = 0xBB67AE85u;
+
+		inline glm::uvec4 Round(const glm::uvec4& counter, const glm::uvec2& key)
+		{
+			uint64_t product0 = (uint64_t)c_M0 * counter.x;
+			uint64_t product1 = (uint64_t)c_M1 * counter.z;
+			uint32_t hi0 = (uint32_t)(product0 >> 32), lo0 = (uint32_t)product0;
+			uint32_t hi1 = (uint32_t)(product1 >> 32), lo1 = (uint32_t)product1;
+			return glm::uvec4(hi1 ^ counter.y ^ key.x, lo1, hi0 ^ counter.w ^ key.y, lo0);
+		}
+
+		inline glm::uvec4 Generate(glm::uvec4 counter, glm::uvec2 key)
+		{
+			for (int round = 0; round < 9; round++)
+			{
+				counter = Round(counter, key);
+				key += glm::uvec2(c_W0, c_W1);
+			}
+			return Round(counter, key);
+		}
+
+		// Top 24 bits, so the result is exact in a float and lies in [0, 1).
+		inline float ToFloat01(uint32_t bits)
+		{
+			return (float)(bits >> 8) * (1.0f / 16777216.0f);
+		}
+
+		inline glm::vec4 ToFloat01(const glm::uvec4& bits)
+		{
+			return glm::vec4(ToFloat01(bits.x), ToFloat01(bits.y), ToFloat01(bits.z), ToFloat01(bits.w));
+		}
+
+		// Counter layout shared with the kernels: x = particle, y = frame, z = stream, w = 0.
+		inline glm::vec4 Uniform4(uint32_t seed, uint32_t particle, uint32_t frame, uint32_t stream)
+		{
+			return ToFloat01(Generate(glm::uvec4(particle, frame, stream, 0u), glm::uvec2(seed, 0u)));
+		}
+	}
+}
@@ -1,20 +1,34 @@
 #include "glclpch.h"
 #include "Engine/Random.h"
+#include "Engine/Philox.h"
 
 namespace Engine
 {
-	void Random::Seed(int seed)
+	uint32_t Random::s_Seed = 0;
+	std::atomic<uint32_t> Random::s_Counter{ 0 };
+
+	// Stream id of the process-wide sequence, distinct from any stream the kernels use.
+	static constexpr uint32_t c_GlobalStream = 0xFFFFFFFFu;
+
+	void Random::Seed(uint32_t seed)
 	{
-		srand(static_cast <unsigned> (seed));
+		s_Seed = seed;
+		s_Counter = 0;
 	}
 
 	void Random::Initialize()
 	{
-		srand(static_cast <unsigned> (time(0)));
+		Seed(static_cast <uint32_t> (time(0)));
 	}
 
 	float Random::RandomRange(float min, float max)
 	{
-		return min + static_cast <float> (rand()) / (static_cast <float> (RAND_MAX / (max - min)));
+		return min + Philox::ToFloat01(RandomUInt()) * (max - min);
+	}
+
+	uint32_t Random::RandomUInt()
+	{
+		uint32_t counter = s_Counter++;
+		return Philox::Generate(glm::uvec4(counter, 0u, c_GlobalStream, 0u), glm::uvec2(s_Seed, 0u)).x;
 	}
 }
\ No newline at end of file
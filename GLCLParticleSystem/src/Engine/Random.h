@@ -1,12 +1,25 @@
 #pragma once
 
+#include <atomic>
+
 namespace Engine
 {
+	// Process-wide numbers for host code that doesn't care which draw it gets.  Backed by
+	// Philox on an atomic counter, so it is safe to call from any thread.  Simulation code
+	// should key Philox::Uniform4 by particle and frame instead, so results don't depend on
+	// scheduling.
 	class Random
 	{
 	public:
-		static void Seed(int seed);
+		static void Seed(uint32_t seed);
 		static void Initialize();
 		static float RandomRange(float min, float max);
+		static uint32_t RandomUInt();
+
+		static uint32_t GetSeed() { return s_Seed; }
+
+	private:
+		static uint32_t s_Seed;
+		static std::atomic<uint32_t> s_Counter;
 	};
 }
\ No newline at end of file
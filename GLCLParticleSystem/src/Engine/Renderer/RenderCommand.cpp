@@ -118,4 +118,22 @@ namespace Engine
 	{
 		glDrawArrays(GL_POINTS, first, vertexCount);
 	}
+
+	GLFence RenderCommand::InsertFence()
+	{
+		return glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	void RenderCommand::WaitFence(GLFence fence)
+	{
+		// Flushing on the first wait makes sure the fence is actually submitted.
+		GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		while (glClientWaitSync(fence, flags, 1000000000) == GL_TIMEOUT_EXPIRED)
+			flags = 0;
+	}
+
+	void RenderCommand::DeleteFence(GLFence fence)
+	{
+		glDeleteSync(fence);
+	}
 }
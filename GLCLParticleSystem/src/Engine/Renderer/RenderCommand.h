@@ -20,6 +20,9 @@ namespace Engine
 
 	enum class FaceCullMode { None = 0, Front, Back };
 
+	// A GL sync object, as GLsync in glad and cl_GLsync in cl_gl_ext.h.
+	using GLFence = struct __GLsync*;
+
 	class RenderCommand
 	{
 	public:
@@ -34,6 +37,11 @@ namespace Engine
 		static void DrawIndexed(VertexArray* vertexArray, uint32_t indexCount = 0, RenderTopology topology = RenderTopology::Triangles);
 		static void DrawPoints(uint32_t vertexCount, uint32_t first = 0);
 		static void DrawArrays(uint32_t vertexCount, uint32_t first = 0, RenderTopology topology = RenderTopology::Triangles);
+
+		// Signalled once every GL command issued before it has completed.
+		static GLFence InsertFence();
+		static void WaitFence(GLFence fence);
+		static void DeleteFence(GLFence fence);
 	};
 }
 
@@ -49,18 +49,24 @@ namespace Engine
 	}
 
 	void VertexArray::AddVertexBuffer(VertexBuffer* vertexBuffer)
+	{
+		AddVertexBuffer(vertexBuffer, m_NextLocation);
+	}
+
+	void VertexArray::AddVertexBuffer(VertexBuffer* vertexBuffer, uint32_t location)
 	{
 		m_VBOs.push_back(vertexBuffer);
+		m_Locations.push_back(location);
+		m_NextLocation = location + (uint32_t)vertexBuffer->GetLayout().GetElements().size();
 	}
 
 	void VertexArray::EnableVertexAttributes()
 	{
-		uint32_t index = 0;
-		uint32_t currentOffset = 0;
-
+		// Each VBO is its own stream, so offsets are relative to its own vertices.
 		for (int i = 0; i < m_VBOs.size(); i++)
 		{
 			VertexBuffer* vbo = m_VBOs[i];
+			uint32_t index = m_Locations[i];
 			glBindVertexArray(m_ID);
 			vbo->Bind();
 
@@ -75,10 +81,9 @@ namespace Engine
 					GLEnumFromShaderDataType(element.Type),
 					element.Normalized ? GL_TRUE : GL_FALSE,
 					layout.GetStride(),
-					(void*)currentOffset
+					(void*)(uintptr_t)element.Offset
 				);
 
-				currentOffset += layout.GetStride();
 				index++;
 			}
 		}
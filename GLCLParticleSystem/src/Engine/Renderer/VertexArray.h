@@ -18,11 +18,16 @@ namespace Engine
 		void ClearIndexBuffer() { m_IndexBuffer = nullptr; }
 		void SetIndexBuffer(IndexBuffer* indexBuffer);
 		IndexBuffer* GetIndexBuffer() const { return m_IndexBuffer; }
+		// The VBO's attributes take the locations after the previous VBO's, or from location on.
+		// Its layout must be set first.
 		void AddVertexBuffer(VertexBuffer* vertexBuffer);
+		void AddVertexBuffer(VertexBuffer* vertexBuffer, uint32_t location);
 		void EnableVertexAttributes();
 
 	private:
 		std::vector<VertexBuffer*> m_VBOs;
+		std::vector<uint32_t> m_Locations;
+		uint32_t m_NextLocation = 0;
 		IndexBuffer* m_IndexBuffer;
 		uint32_t m_ID;
 	};
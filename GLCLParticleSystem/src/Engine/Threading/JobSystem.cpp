@@ -0,0 +1,243 @@
+#include "glclpch.h"
+#include "Engine/Threading/JobSystem.h"
+
+namespace Engine
+{
+	std::atomic<bool> JobSystem::s_Running{ false };
+	std::vector<std::thread> JobSystem::s_Workers;
+	std::vector<JobSystem::WorkerQueue*> JobSystem::s_Queues;
+	std::atomic<uint32_t> JobSystem::s_NextQueue{ 0 };
+	std::atomic<uint32_t> JobSystem::s_QueuedJobs{ 0 };
+	std::mutex JobSystem::s_SleepMutex;
+	std::condition_variable JobSystem::s_WakeCondition;
+
+	// -1 on threads that aren't workers (the main thread, for instance).
+	static thread_local int32_t s_WorkerIndex = -1;
+
+	void JobSystem::Initialize(uint32_t workerCount)
+	{
+		if (s_Running) return;
+
+		if (workerCount == 0)
+			workerCount = std::max(1u, std::thread::hardware_concurrency() - 1);
+
+		s_Running = true;
+
+		for (uint32_t i = 0; i < workerCount; i++)
+			s_Queues.push_back(new WorkerQueue());
+
+		for (uint32_t i = 0; i < workerCount; i++)
+			s_Workers.emplace_back(WorkerLoop, i);
+
+		LOG_INFO("JobSystem initialized with {} workers.", workerCount);
+	}
+
+	void JobSystem::Shutdown()
+	{
+		if (!s_Running) return;
+
+		{
+			std::lock_guard<std::mutex> lock(s_SleepMutex);
+			s_Running = false;
+		}
+		s_WakeCondition.notify_all();
+
+		for (std::thread& worker : s_Workers)
+			worker.join();
+
+		for (WorkerQueue* queue : s_Queues)
+			delete queue;
+
+		s_Workers.clear();
+		s_Queues.clear();
+		s_QueuedJobs = 0;
+	}
+
+	JobHandle JobSystem::Schedule(const std::function<void()>& task, const std::initializer_list<JobHandle>& dependencies)
+	{
+		JobHandle job = std::make_shared<Job>();
+		job->Task = task;
+		AddDependencies(job, dependencies);
+		return job;
+	}
+
+	JobHandle JobSystem::ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& body, const std::initializer_list<JobHandle>& dependencies)
+	{
+		if (grainSize == 0)
+			grainSize = std::max<size_t>(1, count / (GetConcurrency() * 4));
+
+		JobHandle root = std::make_shared<Job>();
+		std::weak_ptr<Job> weakRoot = root;
+
+		// The root splits the range once its dependencies are met and runs the first chunk itself.
+		// Each chunk is a child, so the root only completes when every chunk has.
+		root->Task = [weakRoot, count, grainSize, body]()
+		{
+			JobHandle parent = weakRoot.lock();
+
+			for (size_t begin = grainSize; begin < count; begin += grainSize)
+			{
+				size_t end = std::min(begin + grainSize, count);
+
+				JobHandle chunk = std::make_shared<Job>();
+				chunk->Task = [body, begin, end]() { body(begin, end); };
+				chunk->Parent = parent;
+				parent->Unfinished++;
+				Enqueue(chunk);
+			}
+
+			if (count > 0)
+				body(0, std::min(grainSize, count));
+		};
+
+		AddDependencies(root, dependencies);
+		return root;
+	}
+
+	void JobSystem::Wait(const JobHandle& job)
+	{
+		if (!job) return;
+
+		while (!job->Done)
+		{
+			if (!RunOne(s_WorkerIndex))
+				std::this_thread::yield();
+		}
+	}
+
+	void JobSystem::AddDependencies(const JobHandle& job, const std::initializer_list<JobHandle>& dependencies)
+	{
+		// Hold one extra count while registering so a dependency finishing mid-loop can't launch the job early.
+		job->PendingDependencies = (uint32_t)dependencies.size() + 1;
+
+		for (const JobHandle& dependency : dependencies)
+		{
+			if (!dependency)
+			{
+				job->PendingDependencies--;
+				continue;
+			}
+
+			std::lock_guard<std::mutex> lock(dependency->ContinuationMutex);
+			if (dependency->Done)
+				job->PendingDependencies--;
+			else
+				dependency->Continuations.push_back(job);
+		}
+
+		if (job->PendingDependencies.fetch_sub(1) == 1)
+			Enqueue(job);
+	}
+
+	void JobSystem::Enqueue(const JobHandle& job)
+	{
+		if (s_Queues.empty())
+		{
+			Execute(job);
+			return;
+		}
+
+		uint32_t queueIndex = s_WorkerIndex >= 0 ? (uint32_t)s_WorkerIndex : s_NextQueue++ % (uint32_t)s_Queues.size();
+		WorkerQueue* queue = s_Queues[queueIndex];
+		{
+			std::lock_guard<std::mutex> lock(queue->Mutex);
+			queue->Jobs.push_back(job);
+		}
+
+		s_QueuedJobs++;
+		{
+			std::lock_guard<std::mutex> lock(s_SleepMutex);
+		}
+		s_WakeCondition.notify_one();
+	}
+
+	JobHandle JobSystem::Pop(int32_t workerIndex)
+	{
+		uint32_t queueCount = (uint32_t)s_Queues.size();
+		if (queueCount == 0)
+			return nullptr;
+
+		if (workerIndex >= 0)
+		{
+			WorkerQueue* own = s_Queues[workerIndex];
+			std::lock_guard<std::mutex> lock(own->Mutex);
+			if (!own->Jobs.empty())
+			{
+				JobHandle job = own->Jobs.back();
+				own->Jobs.pop_back();
+				return job;
+			}
+		}
+
+		uint32_t start = workerIndex >= 0 ? (uint32_t)workerIndex : s_NextQueue.load();
+		for (uint32_t i = 1; i <= queueCount; i++)
+		{
+			WorkerQueue* victim = s_Queues[(start + i) % queueCount];
+			std::lock_guard<std::mutex> lock(victim->Mutex);
+			if (!victim->Jobs.empty())
+			{
+				JobHandle job = victim->Jobs.front();
+				victim->Jobs.pop_front();
+				return job;
+			}
+		}
+
+		return nullptr;
+	}
+
+	bool JobSystem::RunOne(int32_t workerIndex)
+	{
+		JobHandle job = Pop(workerIndex);
+		if (!job)
+			return false;
+
+		s_QueuedJobs--;
+		Execute(job);
+		return true;
+	}
+
+	void JobSystem::Execute(const JobHandle& job)
+	{
+		if (job->Task)
+			job->Task();
+
+		Finish(job);
+	}
+
+	void JobSystem::Finish(const JobHandle& job)
+	{
+		if (job->Unfinished.fetch_sub(1) != 1)
+			return;
+
+		std::vector<JobHandle> continuations;
+		{
+			std::lock_guard<std::mutex> lock(job->ContinuationMutex);
+			job->Done = true;
+			continuations.swap(job->Continuations);
+		}
+
+		for (const JobHandle& continuation : continuations)
+			if (continuation->PendingDependencies.fetch_sub(1) == 1)
+				Enqueue(continuation);
+
+		if (job->Parent)
+		{
+			JobHandle parent = std::move(job->Parent);
+			Finish(parent);
+		}
+	}
+
+	void JobSystem::WorkerLoop(uint32_t workerIndex)
+	{
+		s_WorkerIndex = (int32_t)workerIndex;
+
+		while (s_Running)
+		{
+			if (RunOne(s_WorkerIndex))
+				continue;
+
+			std::unique_lock<std::mutex> lock(s_SleepMutex);
+			s_WakeCondition.wait(lock, [] { return !s_Running || s_QueuedJobs > 0; });
+		}
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <deque>
+#include <condition_variable>
+
+namespace Engine
+{
+	struct Job;
+	using JobHandle = std::shared_ptr<Job>;
+
+	struct Job
+	{
+		std::function<void()> Task;
+
+		// Counts this job plus any children it has spawned.  The job completes when it reaches zero.
+		std::atomic<uint32_t> Unfinished{ 1 };
+		std::atomic<uint32_t> PendingDependencies{ 0 };
+		std::atomic<bool> Done{ false };
+
+		JobHandle Parent;
+		std::mutex ContinuationMutex;
+		std::vector<JobHandle> Continuations;
+	};
+
+	// Fixed pool of workers, each with its own deque.  Workers pop their own deque LIFO and
+	// steal FIFO from the others when empty.  Threads that Wait() help execute jobs.
+	class JobSystem
+	{
+	public:
+		static void Initialize(uint32_t workerCount = 0);
+		static void Shutdown();
+
+		static JobHandle Schedule(const std::function<void()>& task, const std::initializer_list<JobHandle>& dependencies = {});
+		static JobHandle ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& body, const std::initializer_list<JobHandle>& dependencies = {});
+		static void Wait(const JobHandle& job);
+
+		// Number of threads that execute jobs, including a thread blocked in Wait().
+		static uint32_t GetConcurrency() { return (uint32_t)s_Workers.size() + 1; }
+		static bool IsInitialized() { return s_Running; }
+
+	private:
+		struct WorkerQueue
+		{
+			std::mutex Mutex;
+			std::deque<JobHandle> Jobs;
+		};
+
+		static void WorkerLoop(uint32_t workerIndex);
+		static void Enqueue(const JobHandle& job);
+		static JobHandle Pop(int32_t workerIndex);
+		static bool RunOne(int32_t workerIndex);
+		static void Execute(const JobHandle& job);
+		static void Finish(const JobHandle& job);
+		static void AddDependencies(const JobHandle& job, const std::initializer_list<JobHandle>& dependencies);
+
+	private:
+		static std::atomic<bool> s_Running;
+		static std::vector<std::thread> s_Workers;
+		static std::vector<WorkerQueue*> s_Queues;
+		static std::atomic<uint32_t> s_NextQueue;
+		static std::atomic<uint32_t> s_QueuedJobs;
+		static std::mutex s_SleepMutex;
+		static std::condition_variable s_WakeCondition;
+	};
+}
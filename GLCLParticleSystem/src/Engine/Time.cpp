@@ -1,17 +1,19 @@
 #include "glclpch.h"
 #include "Engine/Time.h"
 
-#include <GLFW/glfw3.h>
-
 namespace Engine
 {
+	// Steady clock rather than glfwGetTime() so headless runs don't need GLFW initialized.
+	static const std::chrono::steady_clock::time_point s_StartTime = std::chrono::steady_clock::now();
+
 	float Time::s_LastFrameTime = 0.0f;
 	float Time::s_DeltaTime = 0.0f;
 	float Time::s_Elapsed = 0.0f;
 
 	void Time::Tick()
 	{
-		s_Elapsed = (float)glfwGetTime();
+		std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - s_StartTime;
+		s_Elapsed = elapsed.count();
 		s_DeltaTime = s_Elapsed - s_LastFrameTime;
 		s_LastFrameTime = s_Elapsed;
 	}
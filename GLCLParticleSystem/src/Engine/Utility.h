@@ -1,3 +1,23 @@
 #pragma once
 
-#define BIND_FN(fn) [this](auto&& ... args) -> decltype(auto) { return this->fn(std::forward<decltype(args)>(args)...); }
\ No newline at end of file
+#define BIND_FN(fn) [this](auto&& ... args) -> decltype(auto) { return this->fn(std::forward<decltype(args)>(args)...); }
+
+namespace Engine
+{
+	// 64-bit FNV-1a.  Pass the previous result as the seed to hash several pieces as one.
+	inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		uint64_t hash = seed;
+		for (size_t i = 0; i < size; i++)
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		return hash;
+	}
+
+	inline uint64_t HashString(const std::string& text, uint64_t seed = 14695981039346656037ull)
+	{
+		// The length keeps ("ab", "c") and ("a", "bc") apart.
+		uint64_t size = text.size();
+		return HashBytes(text.data(), text.size(), HashBytes(&size, sizeof(size), seed));
+	}
+}
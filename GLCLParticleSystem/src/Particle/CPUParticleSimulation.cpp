@@ -0,0 +1,161 @@
+#include "glclpch.h"
+#include "Particle/CPUParticleSimulation.h"
+#include "Engine/Threading/JobSystem.h"
+#include "Engine/Philox.h"
+
+namespace Engine
+{
+	// Philox streams, matching RNG_STREAM_* in particle_sim.cl.
+	static constexpr uint32_t c_StreamSpawn = 0;
+	static constexpr uint32_t c_StreamSpawnVelocity = 1;
+	// As SPAWN_MAX_TRIES.
+	static constexpr uint32_t c_SpawnMaxTries = 64;
+
+	// Everything here rounds as its twin in particle_sim.cl only without fma contraction, which
+	// the build turns off for this file (premake5.lua).
+	static float UniformRange(float u, float low, float high)
+	{
+		return low + u * (high - low);
+	}
+
+	// x*x + (y*y + z*z), as LengthSquared in particle_sim.cl.
+	static float LengthSquared(float x, float y, float z)
+	{
+		return x * x + (y * y + z * z);
+	}
+
+	CPUParticleSimulation::CPUParticleSimulation(size_t particleCount)
+		:m_ParticleCount(particleCount)
+	{
+		// A few chunks per thread for stealing to balance, rounded to a whole number of
+		// AVX-512 blocks so only the final chunk falls back to the scalar tail.
+		m_GrainSize = particleCount / (JobSystem::GetConcurrency() * 4);
+		m_GrainSize = std::max<size_t>(4096, (m_GrainSize + 63) & ~size_t(63));
+
+		m_Storage.resize(particleCount * 9);
+		float* stream = m_Storage.data();
+		m_Streams.PositionX = stream;	stream += particleCount;
+		m_Streams.PositionY = stream;	stream += particleCount;
+		m_Streams.PositionZ = stream;	stream += particleCount;
+		m_Streams.VelocityX = stream;	stream += particleCount;
+		m_Streams.VelocityY = stream;	stream += particleCount;
+		m_Streams.VelocityZ = stream;	stream += particleCount;
+		m_Streams.ColorR = stream;		stream += particleCount;
+		m_Streams.ColorG = stream;		stream += particleCount;
+		m_Streams.ColorB = stream;
+
+		SetISA(ParticleKernels::DetectISA());
+
+		LOG_INFO("CPU particle simulation: {} particles across {} threads ({}).", particleCount, JobSystem::GetConcurrency(), ParticleKernels::ISAName(m_ISA));
+	}
+
+	void CPUParticleSimulation::SetISA(SimdISA isa)
+	{
+		m_ISA = isa;
+		m_IntegrateRange = ParticleKernels::Select(isa);
+	}
+
+	CPUParticleSimulation::~CPUParticleSimulation()
+	{
+	}
+
+	void CPUParticleSimulation::Dispatch(const std::function<void(size_t, size_t)>& work)
+	{
+		JobSystem::Wait(JobSystem::ParallelFor(m_ParticleCount, m_GrainSize, work));
+	}
+
+	void CPUParticleSimulation::Initialize(const glm::vec3& center, float radius, const glm::vec3& minVelocity, const glm::vec3& maxVelocity, uint32_t seed)
+	{
+		Dispatch([&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					glm::vec4 w = Philox::Uniform4(seed, (uint32_t)i, 0, c_StreamSpawnVelocity);
+
+					// The first of the particle's points in the enclosing cube to land inside the sphere.
+					glm::vec3 offset(0.0f);
+					for (uint32_t attempt = 0; attempt < c_SpawnMaxTries; attempt++)
+					{
+						glm::vec4 u = Philox::Uniform4(seed, (uint32_t)i, attempt, c_StreamSpawn);
+						glm::vec3 candidate(2.0f * u.x - 1.0f, 2.0f * u.y - 1.0f, 2.0f * u.z - 1.0f);
+						if (LengthSquared(candidate.x, candidate.y, candidate.z) < 1.0f)
+						{
+							offset = candidate;
+							break;
+						}
+					}
+
+					m_Streams.PositionX[i] = center.x + offset.x * radius;
+					m_Streams.PositionY[i] = center.y + offset.y * radius;
+					m_Streams.PositionZ[i] = center.z + offset.z * radius;
+					m_Streams.VelocityX[i] = UniformRange(w.x, minVelocity.x, maxVelocity.x);
+					m_Streams.VelocityY[i] = UniformRange(w.y, minVelocity.y, maxVelocity.y);
+					m_Streams.VelocityZ[i] = UniformRange(w.z, minVelocity.z, maxVelocity.z);
+					m_Streams.ColorR[i] = m_Streams.ColorG[i] = m_Streams.ColorB[i] = 1.0f;
+				}
+			});
+	}
+
+	void CPUParticleSimulation::Step(const SimulationBounds& bounds, const std::vector<glm::vec4>& spheres, const ColliderGrid& grid, float time,
+		uint32_t seed, uint32_t firstPulse, uint32_t pulseCount)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		const glm::vec3& minExtent = bounds.GetMinExtents();
+		const glm::vec3& maxExtent = bounds.GetMaxExtents();
+		const glm::vec3& center = bounds.GetCenter();
+
+		float boundsSize = (float)std::abs((long)(maxExtent.x - minExtent.x));
+		glm::vec3 columnHalfSize = glm::vec3(boundsSize / 4.0f, boundsSize / 2.0f, boundsSize / 4.0f) / 2.0f;
+
+		ParticleStepParams params;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			params.MinExtent[axis] = minExtent[axis];
+			params.MaxExtent[axis] = maxExtent[axis];
+			params.ColumnMin[axis] = center[axis] - columnHalfSize[axis];
+			params.ColumnMax[axis] = center[axis] + columnHalfSize[axis];
+		}
+
+		size_t sphereCount = spheres.size();
+		m_SphereData.resize(sphereCount * 4);
+		for (size_t i = 0; i < sphereCount; i++)
+		{
+			m_SphereData[i] = spheres[i].x;
+			m_SphereData[sphereCount + i] = spheres[i].y;
+			m_SphereData[sphereCount * 2 + i] = spheres[i].z;
+			m_SphereData[sphereCount * 3 + i] = spheres[i].w * spheres[i].w;
+		}
+
+		params.SphereX = m_SphereData.data();
+		params.SphereY = params.SphereX + sphereCount;
+		params.SphereZ = params.SphereY + sphereCount;
+		params.SphereRadiusSquared = params.SphereZ + sphereCount;
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			params.GridOrigin[axis] = grid.GetOrigin()[axis];
+			params.GridInvCellSize[axis] = 1.0f / grid.GetCellSize()[axis];
+			params.GridDimensions[axis] = grid.GetDimensions()[axis];
+		}
+		params.GridCells = &grid.GetCells()[0].x;
+		params.GridIndices = grid.GetIndices().data();
+		params.Time = time;
+		params.TimeStep = m_TimeStep;
+		params.Gravity = m_Gravity;
+		params.Substeps = m_Substeps;
+		params.Seed = seed;
+		params.FirstPulse = firstPulse;
+		params.PulseCount = pulseCount;
+		params.BoundsSize = boundsSize;
+
+		Dispatch([&](size_t begin, size_t end)
+			{
+				m_IntegrateRange(m_Streams, params, begin, end);
+			});
+
+		auto end = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<double> elapsed = end - start;
+		m_SumTimeS += elapsed.count();
+	}
+}
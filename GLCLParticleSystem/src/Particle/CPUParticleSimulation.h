@@ -0,0 +1,56 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include "Particle/SimulationBounds.h"
+#include "Particle/ColliderGrid.h"
+#include "Particle/Simd/ParticleKernels.h"
+
+namespace Engine
+{
+	// Host-side mirror of the ParticleSimulation kernel, pulses included, in particle_sim.cl.
+	// Used when no OpenCL device (or no GL context) is available.  State is stored as
+	// structure-of-arrays and stepped by the widest SIMD kernel the CPU supports.  Every
+	// operation matches the kernels' in kind and order, so the same seed gives the same
+	// positions and velocities, bit for bit, on a device that rounds divide and sqrt correctly.
+	class CPUParticleSimulation
+	{
+	public:
+		CPUParticleSimulation(size_t particleCount);
+		~CPUParticleSimulation();
+
+		// Spawns every particle uniformly in the sphere with a random velocity, like the
+		// InitializeParticles kernel, in parallel across the job system.
+		void Initialize(const glm::vec3& center, float radius, const glm::vec3& minVelocity, const glm::vec3& maxVelocity, uint32_t seed);
+		// Pulses firstPulse to firstPulse + pulseCount - 1 are applied first, in the same pass.
+		void Step(const SimulationBounds& bounds, const std::vector<glm::vec4>& spheres, const ColliderGrid& grid, float time,
+			uint32_t seed = 0, uint32_t firstPulse = 0, uint32_t pulseCount = 0);
+
+		const ParticleStreams& GetStreams() const { return m_Streams; }
+		void SetISA(SimdISA isa);
+		// Matches ParticleSystemProperties::TimeStep, Gravity and Substeps.
+		void SetIntegration(float timeStep, float gravity, uint32_t substeps) { m_TimeStep = timeStep; m_Gravity = gravity; m_Substeps = substeps; }
+
+		size_t GetParticleCount() const { return m_ParticleCount; }
+		SimdISA GetISA() const { return m_ISA; }
+		double GetSumTime() const { return m_SumTimeS; }
+
+	private:
+		void Dispatch(const std::function<void(size_t, size_t)>& work);
+
+	private:
+		double m_SumTimeS = 0.0;
+		size_t m_ParticleCount;
+		size_t m_GrainSize;
+		SimdISA m_ISA;
+		IntegrateRangeFn m_IntegrateRange;
+		float m_TimeStep = 0.00125f;
+		float m_Gravity = -9.8f * 4.0f;
+		uint32_t m_Substeps = 1;
+
+		// One allocation holding all nine attribute streams back to back.
+		std::vector<float> m_Storage;
+		ParticleStreams m_Streams;
+
+		std::vector<float> m_SphereData;
+	};
+}
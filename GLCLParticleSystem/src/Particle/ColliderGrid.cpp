@@ -0,0 +1,90 @@
+#include "glclpch.h"
+#include "Particle/ColliderGrid.h"
+
+#include <cfloat>
+
+namespace Engine
+{
+	void ColliderGrid::Build(const std::vector<glm::vec4>& spheres)
+	{
+		m_Cells.clear();
+		m_Indices.clear();
+
+		glm::vec3 minExtent(FLT_MAX);
+		glm::vec3 maxExtent(-FLT_MAX);
+		float meanDiameter = 0.0f;
+
+		for (const glm::vec4& sphere : spheres)
+		{
+			minExtent = glm::min(minExtent, glm::vec3(sphere) - sphere.w);
+			maxExtent = glm::max(maxExtent, glm::vec3(sphere) + sphere.w);
+			meanDiameter += sphere.w * 2.0f;
+		}
+
+		if (spheres.empty())
+		{
+			m_Origin = glm::vec3(0.0f);
+			m_CellSize = glm::vec3(1.0f);
+			m_Dimensions = glm::ivec3(1);
+		}
+		else
+		{
+			meanDiameter /= (float)spheres.size();
+			glm::vec3 size = glm::max(maxExtent - minExtent, glm::vec3(1e-4f));
+
+			// Aim for a couple of cells per collider, but keep cells at least as wide as an
+			// average collider so no sphere is copied into more than a handful of them.
+			float cellEdge = std::cbrt(size.x * size.y * size.z / (2.0f * spheres.size()));
+			cellEdge = std::max(cellEdge, meanDiameter);
+
+			m_Dimensions = glm::clamp(glm::ivec3(glm::ceil(size / cellEdge)), glm::ivec3(1), glm::ivec3(c_MaxDimension));
+			m_Origin = minExtent;
+			m_CellSize = size / glm::vec3(m_Dimensions);
+		}
+
+		size_t cellCount = (size_t)m_Dimensions.x * m_Dimensions.y * m_Dimensions.z;
+		m_Cells.assign(cellCount, glm::uvec2(0));
+
+		// Visits every cell the sphere actually intersects, not just its bounding box.
+		auto forEachCell = [this](const glm::vec4& sphere, auto&& visit)
+		{
+			glm::vec3 center = glm::vec3(sphere);
+			glm::ivec3 low = glm::clamp(glm::ivec3(glm::floor((center - sphere.w - m_Origin) / m_CellSize)), glm::ivec3(0), m_Dimensions - 1);
+			glm::ivec3 high = glm::clamp(glm::ivec3(glm::floor((center + sphere.w - m_Origin) / m_CellSize)), glm::ivec3(0), m_Dimensions - 1);
+
+			for (int32_t z = low.z; z <= high.z; z++)
+				for (int32_t y = low.y; y <= high.y; y++)
+					for (int32_t x = low.x; x <= high.x; x++)
+					{
+						glm::vec3 cellMin = m_Origin + glm::vec3(x, y, z) * m_CellSize;
+						glm::vec3 offset = glm::clamp(center, cellMin, cellMin + m_CellSize) - center;
+						if (glm::dot(offset, offset) > sphere.w * sphere.w)
+							continue;
+
+						visit((z * m_Dimensions.y + y) * m_Dimensions.x + x);
+					}
+		};
+
+		for (const glm::vec4& sphere : spheres)
+			forEachCell(sphere, [this](int32_t cell) { m_Cells[cell].y++; });
+
+		uint32_t first = 0;
+		for (glm::uvec2& cell : m_Cells)
+		{
+			cell.x = first;
+			first += cell.y;
+			cell.y = 0;
+		}
+
+		// Filling in sphere order keeps every cell's list ascending.
+		m_Indices.resize(first);
+		for (uint32_t i = 0; i < (uint32_t)spheres.size(); i++)
+			forEachCell(spheres[i], [this, i](int32_t cell) { m_Indices[m_Cells[cell].x + m_Cells[cell].y++] = i; });
+
+		// Device buffers can't be empty.  Every count is zero in this case so it is never read.
+		if (m_Indices.empty())
+			m_Indices.push_back(0);
+
+		LOG_INFO("Collider grid: {} spheres in {}x{}x{} cells, {} entries.", spheres.size(), m_Dimensions.x, m_Dimensions.y, m_Dimensions.z, first);
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace Engine
+{
+	// Uniform grid over the bounds of the sphere colliders.  Every cell lists, in ascending
+	// order, the spheres overlapping it, so a particle only tests the spheres of the cell it
+	// falls in and the lowest-index sphere still wins, as it did with the linear loop.
+	class ColliderGrid
+	{
+	public:
+		void Build(const std::vector<glm::vec4>& spheres);
+
+		const glm::vec3& GetOrigin() const { return m_Origin; }
+		const glm::vec3& GetCellSize() const { return m_CellSize; }
+		const glm::ivec3& GetDimensions() const { return m_Dimensions; }
+		// Per cell: (first entry in GetIndices(), entry count).
+		const std::vector<glm::uvec2>& GetCells() const { return m_Cells; }
+		const std::vector<uint32_t>& GetIndices() const { return m_Indices; }
+
+	private:
+		static constexpr int32_t c_MaxDimension = 128;
+
+		glm::vec3 m_Origin = glm::vec3(0.0f);
+		glm::vec3 m_CellSize = glm::vec3(1.0f);
+		glm::ivec3 m_Dimensions = glm::ivec3(1);
+		std::vector<glm::uvec2> m_Cells;
+		std::vector<uint32_t> m_Indices;
+	};
+}
@@ -0,0 +1,73 @@
+#include "glclpch.h"
+#include "Particle/DevicePartitioner.h"
+
+#include <cmath>
+
+namespace Engine
+{
+	// Weight of the newest sample.  Low enough that one slow frame doesn't swing the split.
+	static constexpr double c_Smoothing = 0.25;
+
+	DevicePartitioner::DevicePartitioner(size_t count, uint32_t deviceCount, size_t granularity)
+		:m_Count(count), m_Granularity(granularity), m_Ranges(deviceCount), m_Throughput(deviceCount, 0.0)
+	{
+		// Even split until there is something to measure.
+		size_t granules = count / granularity;
+		size_t start = 0;
+		for (uint32_t i = 0; i < deviceCount; i++)
+		{
+			size_t share = i + 1 < deviceCount ? granules / deviceCount * granularity : count - start;
+			m_Ranges[i] = { start, share };
+			start += share;
+		}
+	}
+
+	void DevicePartitioner::Sample(uint32_t device, double seconds)
+	{
+		if (seconds <= 0.0)
+			return;
+
+		double throughput = m_Ranges[device].Count / seconds;
+		double& smoothed = m_Throughput[device];
+		smoothed = smoothed == 0.0 ? throughput : smoothed + (throughput - smoothed) * c_Smoothing;
+	}
+
+	bool DevicePartitioner::Rebalance()
+	{
+		double total = 0.0;
+		for (double throughput : m_Throughput)
+		{
+			if (throughput == 0.0)
+				return false;
+			total += throughput;
+		}
+
+		uint32_t deviceCount = GetDeviceCount();
+		size_t granules = m_Count / m_Granularity;
+		std::vector<Range> ranges(deviceCount);
+		size_t start = 0;
+		for (uint32_t i = 0; i < deviceCount; i++)
+		{
+			size_t share = m_Count - start;
+			if (i + 1 < deviceCount)
+			{
+				// Leave at least one granule for every device still to come.
+				size_t remaining = (m_Count - start) / m_Granularity - (deviceCount - i - 1);
+				size_t target = (size_t)std::llround(granules * m_Throughput[i] / total);
+				share = std::clamp<size_t>(target, 1, remaining) * m_Granularity;
+			}
+			ranges[i] = { start, share };
+			start += share;
+		}
+
+		// Moving a boundary means rebuilding the sub-buffers, so noise-sized changes are ignored.
+		size_t deadBand = std::max(m_Granularity, m_Count / 100);
+		bool moved = false;
+		for (uint32_t i = 0; i < deviceCount; i++)
+			moved |= (ranges[i].Count > m_Ranges[i].Count ? ranges[i].Count - m_Ranges[i].Count : m_Ranges[i].Count - ranges[i].Count) > deadBand;
+
+		if (moved)
+			m_Ranges = ranges;
+		return moved;
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+namespace Engine
+{
+	// Splits [0, count) into one contiguous range per device and moves the boundaries toward
+	// each device's measured throughput.  Ranges start on multiples of the granularity, so a
+	// range can back a sub-buffer and a whole number of work-groups, and none is ever empty.
+	class DevicePartitioner
+	{
+	public:
+		struct Range
+		{
+			size_t Start;
+			size_t Count;
+		};
+
+		// count must be a multiple of granularity and hold at least one granule per device.
+		DevicePartitioner(size_t count, uint32_t deviceCount, size_t granularity);
+
+		uint32_t GetDeviceCount() const { return (uint32_t)m_Ranges.size(); }
+		const Range& GetRange(uint32_t device) const { return m_Ranges[device]; }
+
+		// Records that device took seconds to process its current range.
+		void Sample(uint32_t device, double seconds);
+		// Resizes the ranges in proportion to the smoothed throughput of each device, unless every
+		// share would move by less than about 1%.  Returns true when the ranges changed, in which
+		// case anything built on them must be rebuilt.
+		bool Rebalance();
+
+	private:
+		size_t m_Count;
+		size_t m_Granularity;
+		std::vector<Range> m_Ranges;
+		// Items per second, exponentially smoothed.  0 until the device's first sample.
+		std::vector<double> m_Throughput;
+	};
+}
@@ -0,0 +1,54 @@
+#include "glclpch.h"
+#include "Particle/MortonReorder.h"
+
+namespace Engine
+{
+	MortonReorder::MortonReorder(OpenCLProgram* program, ParticleRadixSort* sorter, OpenCLBuffer* positionBuffer, OpenCLBuffer* boundsBuffer, const std::vector<OpenCLBuffer*>& attributeBuffers, size_t particleCount)
+		:m_Program(program), m_Sorter(sorter), m_ParticleCount((cl_uint)particleCount), m_AttributeBuffers(attributeBuffers)
+	{
+		const uint32_t groupSize = ParticleRadixSort::GroupSize;
+		m_ParticleWorkSize = glm::ivec3((particleCount + groupSize - 1) / groupSize * groupSize, 1, 1);
+		m_GroupWorkSize = glm::ivec3(groupSize, 1, 1);
+
+		m_ScratchBuffer = new OpenCLBuffer(program, "reorderScratch", sizeof(cl_float4) * particleCount, CLBufferType::ReadWrite);
+		m_ScratchHandle = program->AddBuffer(m_ScratchBuffer);
+		for (OpenCLBuffer* buffer : attributeBuffers)
+			m_AttributeHandles.push_back(program->GetBufferHandle(buffer->GetBufferName()));
+
+		OpenCLKernel* keysKernel = new OpenCLKernel(program, "ComputeMortonKeys",
+			{
+				KernelArg::FromBuffer(positionBuffer),
+				KernelArg::FromBuffer(boundsBuffer),
+				KernelArg::FromBuffer(sorter->GetKeyBuffer()),
+				KernelArg::FromBuffer(sorter->GetValueBuffer()),
+				KernelArg::FromValue("count", &m_ParticleCount, sizeof(cl_uint)),
+			});
+		m_GatherKernel = new OpenCLKernel(program, "GatherFloat4",
+			{
+				KernelArg::FromBuffer(positionBuffer),
+				KernelArg::FromBuffer(m_ScratchBuffer),
+				KernelArg::FromBuffer(sorter->GetValueBuffer()),
+				KernelArg::FromValue("count", &m_ParticleCount, sizeof(cl_uint)),
+			});
+
+		keysKernel->SetBytesPerWorkItem(sizeof(cl_float4) + sizeof(cl_uint) * 2);
+		m_GatherKernel->SetBytesPerWorkItem(sizeof(cl_float4) * 2 + sizeof(cl_uint));
+
+		m_KeysHandle = program->AddKernel(keysKernel);
+		m_GatherHandle = program->AddKernel(m_GatherKernel);
+	}
+
+	void MortonReorder::Reorder()
+	{
+		m_Program->Execute(m_KeysHandle, m_ParticleWorkSize, m_GroupWorkSize);
+		m_Sorter->Sort(c_KeyBits);
+
+		// GL buffers can't be swapped under the VBOs, so gather into scratch and copy back.
+		for (size_t i = 0; i < m_AttributeBuffers.size(); i++)
+		{
+			m_GatherKernel->SetArgData(0, m_AttributeBuffers[i]->GetBufferID());
+			m_Program->Execute(m_GatherHandle, m_ParticleWorkSize, m_GroupWorkSize);
+			m_Program->CopyDeviceBuffer(m_ScratchHandle, m_AttributeHandles[i]);
+		}
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include "Engine/Compute/OpenCLProgram.h"
+#include "Particle/ParticleRadixSort.h"
+
+#include <OpenCL/cl.h>
+
+namespace Engine
+{
+	// Sorts every particle attribute buffer by the 30-bit Morton code of the particle's position
+	// within the simulation bounds, so particles close in space are also close in memory.
+	class MortonReorder
+	{
+	public:
+		// attributeBuffers are float4 per particle and gathered in place through one scratch buffer.
+		MortonReorder(OpenCLProgram* program, ParticleRadixSort* sorter, OpenCLBuffer* positionBuffer, OpenCLBuffer* boundsBuffer, const std::vector<OpenCLBuffer*>& attributeBuffers, size_t particleCount);
+
+		// Enqueues the key, sort, gather and copy passes.  Every attribute buffer must be acquired.
+		void Reorder();
+
+	private:
+		static constexpr uint32_t c_KeyBits = 30;
+
+		OpenCLProgram* m_Program;
+		ParticleRadixSort* m_Sorter;
+		cl_uint m_ParticleCount;
+
+		OpenCLBuffer* m_ScratchBuffer;
+		OpenCLKernel* m_GatherKernel;
+		std::vector<OpenCLBuffer*> m_AttributeBuffers;
+
+		KernelHandle m_KeysHandle;
+		KernelHandle m_GatherHandle;
+		BufferHandle m_ScratchHandle;
+		std::vector<BufferHandle> m_AttributeHandles;
+
+		glm::ivec3 m_ParticleWorkSize;
+		glm::ivec3 m_GroupWorkSize;
+	};
+}
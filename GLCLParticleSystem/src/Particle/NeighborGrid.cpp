@@ -0,0 +1,79 @@
+#include "glclpch.h"
+#include "Particle/NeighborGrid.h"
+
+namespace Engine
+{
+	NeighborGrid::NeighborGrid(OpenCLProgram* program, ParticleRadixSort* sorter, OpenCLBuffer* positionBuffer, size_t particleCount, const glm::vec3& origin, float cellSize, uint32_t tableBits)
+		:m_Program(program), m_Sorter(sorter), m_ParticleCount((cl_uint)particleCount)
+	{
+		const uint32_t groupSize = ParticleRadixSort::GroupSize;
+
+		// The table is cleared in whole work-groups, so it can't be smaller than one.
+		m_TableBits = glm::clamp(tableBits, 8u, 28u);
+		size_t tableSize = size_t(1) << m_TableBits;
+
+		m_ParticleWorkSize = glm::ivec3((particleCount + groupSize - 1) / groupSize * groupSize, 1, 1);
+		m_TableWorkSize = glm::ivec3(tableSize, 1, 1);
+		m_GroupWorkSize = glm::ivec3(groupSize, 1, 1);
+
+		cl_float4 gridOrigin = { origin.x, origin.y, origin.z, 0.0f };
+		m_HashGridPtr = new cl_hash_grid();
+		m_HashGridPtr->Origin = gridOrigin;
+		m_HashGridPtr->InvCellSize = 1.0f / cellSize;
+		m_HashGridPtr->TableMask = (cl_uint)(tableSize - 1);
+
+		m_HashGridBuffer =		new OpenCLBuffer(program, "hashGrid",		sizeof(cl_hash_grid),			CLBufferType::ReadOnly);
+		m_CellStartBuffer =		new OpenCLBuffer(program, "cellStart",		sizeof(cl_uint) * tableSize,	CLBufferType::ReadWrite);
+		m_CellEndBuffer =		new OpenCLBuffer(program, "cellEnd",		sizeof(cl_uint) * tableSize,	CLBufferType::ReadWrite);
+
+		BufferHandle hashGridHandle = program->AddBuffer(m_HashGridBuffer);
+		program->AddBuffer(m_CellStartBuffer);
+		program->AddBuffer(m_CellEndBuffer);
+
+		OpenCLKernel* keysKernel = new OpenCLKernel(program, "ComputeCellKeys",
+			{
+				KernelArg::FromBuffer(positionBuffer),
+				KernelArg::FromBuffer(m_HashGridBuffer),
+				KernelArg::FromBuffer(sorter->GetKeyBuffer()),
+				KernelArg::FromBuffer(sorter->GetValueBuffer()),
+				KernelArg::FromValue("count", &m_ParticleCount, sizeof(cl_uint)),
+			});
+		OpenCLKernel* clearKernel = new OpenCLKernel(program, "ClearCellRanges",
+			{
+				KernelArg::FromBuffer(m_CellStartBuffer),
+				KernelArg::FromBuffer(m_CellEndBuffer),
+			});
+		OpenCLKernel* rangesKernel = new OpenCLKernel(program, "FindCellRanges",
+			{
+				KernelArg::FromBuffer(sorter->GetKeyBuffer()),
+				KernelArg::FromBuffer(m_CellStartBuffer),
+				KernelArg::FromBuffer(m_CellEndBuffer),
+				KernelArg::FromValue("count", &m_ParticleCount, sizeof(cl_uint)),
+			});
+
+		keysKernel->SetBytesPerWorkItem(sizeof(cl_float4) + sizeof(cl_uint) * 2);
+		clearKernel->SetBytesPerWorkItem(sizeof(cl_uint) * 2);
+		rangesKernel->SetBytesPerWorkItem(sizeof(cl_uint) * 3);
+
+		m_KeysHandle = program->AddKernel(keysKernel);
+		m_ClearHandle = program->AddKernel(clearKernel);
+		m_RangesHandle = program->AddKernel(rangesKernel);
+
+		program->WriteToDeviceBufferFromHostBuffer(hashGridHandle, sizeof(cl_hash_grid), m_HashGridPtr);
+
+		LOG_INFO("Neighbor grid: {} particles, cell size {}, {} hash cells.", particleCount, cellSize, tableSize);
+	}
+
+	NeighborGrid::~NeighborGrid()
+	{
+		delete m_HashGridPtr;
+	}
+
+	void NeighborGrid::Build()
+	{
+		m_Program->Execute(m_KeysHandle, m_ParticleWorkSize, m_GroupWorkSize);
+		m_Sorter->Sort(m_TableBits);
+		m_Program->Execute(m_ClearHandle, m_TableWorkSize, m_GroupWorkSize);
+		m_Program->Execute(m_RangesHandle, m_ParticleWorkSize, m_GroupWorkSize);
+	}
+}
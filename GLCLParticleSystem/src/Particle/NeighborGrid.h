@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include "Engine/Compute/OpenCLProgram.h"
+#include "Particle/ParticleRadixSort.h"
+
+#include <OpenCL/cl.h>
+
+namespace Engine
+{
+	struct cl_hash_grid
+	{
+		cl_float4 Origin;
+		cl_float InvCellSize;
+		cl_uint TableMask;
+		cl_uint Padding[2];
+	};
+
+	// Device spatial hash over the particle positions, rebuilt with Build() every step.
+	// Particles are hashed to cells of the interaction radius, radix sorted by cell key, and
+	// every key's [start, end) range in the sorted order is recorded.  Kernels in the same
+	// program bind the buffers below and walk neighbors with FOR_EACH_NEIGHBOR.
+	class NeighborGrid
+	{
+	public:
+		// The kernels and buffers are registered with, and owned by, the program.  The sorted
+		// indices live in the sorter's value buffer, so it must not be reused until they're consumed.
+		NeighborGrid(OpenCLProgram* program, ParticleRadixSort* sorter, OpenCLBuffer* positionBuffer, size_t particleCount, const glm::vec3& origin, float cellSize, uint32_t tableBits);
+		~NeighborGrid();
+
+		// Enqueues the hash, sort and cell-range passes.  The position buffer must be acquired.
+		void Build();
+
+		OpenCLBuffer* GetHashGridBuffer() const { return m_HashGridBuffer; }
+		OpenCLBuffer* GetCellStartBuffer() const { return m_CellStartBuffer; }
+		OpenCLBuffer* GetCellEndBuffer() const { return m_CellEndBuffer; }
+		OpenCLBuffer* GetSortedIndexBuffer() const { return m_Sorter->GetValueBuffer(); }
+
+	private:
+		OpenCLProgram* m_Program;
+		ParticleRadixSort* m_Sorter;
+		uint32_t m_TableBits;
+		cl_uint m_ParticleCount;
+		cl_hash_grid* m_HashGridPtr = nullptr;
+
+		OpenCLBuffer* m_HashGridBuffer;
+		OpenCLBuffer* m_CellStartBuffer;
+		OpenCLBuffer* m_CellEndBuffer;
+
+		KernelHandle m_KeysHandle;
+		KernelHandle m_ClearHandle;
+		KernelHandle m_RangesHandle;
+
+		glm::ivec3 m_ParticleWorkSize;
+		glm::ivec3 m_TableWorkSize;
+		glm::ivec3 m_GroupWorkSize;
+	};
+}
@@ -0,0 +1,65 @@
+#include "glclpch.h"
+#include "Particle/ParticleRadixSort.h"
+
+namespace Engine
+{
+	ParticleRadixSort::ParticleRadixSort(OpenCLProgram* program, size_t count)
+		:m_Program(program), m_Count((cl_uint)count)
+	{
+		size_t groupCount = (count + c_BlockSize - 1) / c_BlockSize;
+		m_HistogramLength = (cl_uint)(groupCount * c_RadixBuckets);
+
+		m_BlockWorkSize = glm::ivec3(groupCount * GroupSize, 1, 1);
+		m_ScanWorkSize = glm::ivec3(GroupSize, 1, 1);
+		m_GroupWorkSize = glm::ivec3(GroupSize, 1, 1);
+
+		size_t bytes = sizeof(cl_uint) * count;
+		m_KeyBuffers[0] =		new OpenCLBuffer(program, "sortKeys",			bytes,									CLBufferType::ReadWrite);
+		m_KeyBuffers[1] =		new OpenCLBuffer(program, "sortKeysAlt",		bytes,									CLBufferType::ReadWrite);
+		m_ValueBuffers[0] =		new OpenCLBuffer(program, "sortValues",			bytes,									CLBufferType::ReadWrite);
+		m_ValueBuffers[1] =		new OpenCLBuffer(program, "sortValuesAlt",		bytes,									CLBufferType::ReadWrite);
+		m_HistogramBuffer =		new OpenCLBuffer(program, "radixHistogram",		sizeof(cl_uint) * m_HistogramLength,	CLBufferType::ReadWrite);
+
+		for (OpenCLBuffer* buffer : { m_KeyBuffers[0], m_KeyBuffers[1], m_ValueBuffers[0], m_ValueBuffers[1], m_HistogramBuffer })
+			program->AddBuffer(buffer);
+
+		m_CountKernel = new OpenCLKernel(program, "RadixCount",
+			{ KernelArg::FromBuffer(m_KeyBuffers[0]), KernelArg::FromBuffer(m_HistogramBuffer), KernelArg::FromValue("count", &m_Count, sizeof(cl_uint)), KernelArg::FromValue("shift", &m_Shift, sizeof(cl_uint)) });
+		OpenCLKernel* scanKernel = new OpenCLKernel(program, "RadixScan",
+			{ KernelArg::FromBuffer(m_HistogramBuffer), KernelArg::FromValue("length", &m_HistogramLength, sizeof(cl_uint)) });
+		m_ScatterKernel = new OpenCLKernel(program, "RadixScatter",
+			{ KernelArg::FromBuffer(m_KeyBuffers[0]), KernelArg::FromBuffer(m_ValueBuffers[0]), KernelArg::FromBuffer(m_KeyBuffers[1]), KernelArg::FromBuffer(m_ValueBuffers[1]), KernelArg::FromBuffer(m_HistogramBuffer), KernelArg::FromValue("count", &m_Count, sizeof(cl_uint)), KernelArg::FromValue("shift", &m_Shift, sizeof(cl_uint)) });
+
+		// Each work-item covers sixteen keys: counting reads them, scattering reads them twice
+		// plus their values and writes both out.
+		m_CountKernel->SetBytesPerWorkItem(sizeof(cl_uint) * c_ItemsPerThread);
+		m_ScatterKernel->SetBytesPerWorkItem(sizeof(cl_uint) * 5 * c_ItemsPerThread);
+
+		m_CountHandle = program->AddKernel(m_CountKernel);
+		m_ScanHandle = program->AddKernel(scanKernel);
+		m_ScatterHandle = program->AddKernel(m_ScatterKernel);
+	}
+
+	void ParticleRadixSort::Sort(uint32_t keyBits)
+	{
+		uint32_t passCount = (keyBits + c_RadixBits - 1) / c_RadixBits;
+		passCount += passCount & 1;
+
+		for (uint32_t pass = 0; pass < passCount; pass++)
+		{
+			uint32_t source = pass & 1;
+			uint32_t destination = source ^ 1;
+
+			m_Shift = pass * c_RadixBits;
+			m_CountKernel->SetArgData(0, m_KeyBuffers[source]->GetBufferID());
+			m_ScatterKernel->SetArgData(0, m_KeyBuffers[source]->GetBufferID());
+			m_ScatterKernel->SetArgData(1, m_ValueBuffers[source]->GetBufferID());
+			m_ScatterKernel->SetArgData(2, m_KeyBuffers[destination]->GetBufferID());
+			m_ScatterKernel->SetArgData(3, m_ValueBuffers[destination]->GetBufferID());
+
+			m_Program->Execute(m_CountHandle, m_BlockWorkSize, m_GroupWorkSize);
+			m_Program->Execute(m_ScanHandle, m_ScanWorkSize, m_GroupWorkSize);
+			m_Program->Execute(m_ScatterHandle, m_BlockWorkSize, m_GroupWorkSize);
+		}
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include "Engine/Compute/OpenCLProgram.h"
+
+#include <OpenCL/cl.h>
+
+namespace Engine
+{
+	// Stable device LSD radix sort of (key, value) uint pairs, 4 bits per pass, using the
+	// Radix* kernels in particle_sim.cl.  Callers fill the key/value buffers with their own
+	// kernels, call Sort(), and read the results back from the same buffers.
+	class ParticleRadixSort
+	{
+	public:
+		// The kernels and buffers are registered with, and owned by, the program.
+		ParticleRadixSort(OpenCLProgram* program, size_t count);
+
+		// Sorts by the low keyBits bits.  Passes are rounded up to an even count so the
+		// ping-pong always lands back in the key/value buffers.
+		void Sort(uint32_t keyBits);
+
+		OpenCLBuffer* GetKeyBuffer() const { return m_KeyBuffers[0]; }
+		OpenCLBuffer* GetValueBuffer() const { return m_ValueBuffers[0]; }
+
+		static constexpr uint32_t GroupSize = 256;
+
+	private:
+		static constexpr uint32_t c_RadixBits = 4;
+		static constexpr uint32_t c_RadixBuckets = 1 << c_RadixBits;
+		static constexpr uint32_t c_ItemsPerThread = 16;
+		static constexpr uint32_t c_BlockSize = GroupSize * c_ItemsPerThread;
+
+		OpenCLProgram* m_Program;
+		cl_uint m_Count;
+		cl_uint m_HistogramLength;
+		cl_uint m_Shift = 0;
+
+		OpenCLBuffer* m_KeyBuffers[2];
+		OpenCLBuffer* m_ValueBuffers[2];
+		OpenCLBuffer* m_HistogramBuffer;
+
+		OpenCLKernel* m_CountKernel;
+		OpenCLKernel* m_ScatterKernel;
+		KernelHandle m_CountHandle;
+		KernelHandle m_ScanHandle;
+		KernelHandle m_ScatterHandle;
+
+		glm::ivec3 m_BlockWorkSize;
+		glm::ivec3 m_ScanWorkSize;
+		glm::ivec3 m_GroupWorkSize;
+	};
+}
@@ -1,13 +1,14 @@
 #include "glclpch.h"
 #include "Particle/ParticleSystem.h"
+#include "Engine/Compute/OpenCLContext.h"
+#include "Engine/Compute/OpenCLAutotuner.h"
 #include "Engine/Renderer/RenderCommand.h"
 
 #include "Engine/Input.h"
 
 #include "Engine/Random.h"
 #include <glm/glm.hpp>
-
-#define PI 3.14159265359
+#include <numeric>
 
 namespace Engine
 {
@@ -17,9 +18,9 @@ namespace Engine
 		size_t dataSize = properties.ParticleCount * sizeof(float) * 4;
 		m_Properties.ColorDataByteSize = m_Properties.PositionDataByteSize = m_Properties.VelocityDataByteSize = dataSize;
 
-		m_GlobalWorkSize = glm::ivec3(properties.ParticleCount, 1, 1);
-		m_LocalWorkSize = glm::ivec3(c_ThreadsPerWorkGroup, 1, 1);
-		m_World = new SimulationWorld();
+		ParticleLaunch launch = { glm::ivec3(properties.ParticleCount, 1, 1), glm::ivec3(properties.LocalWorkSize, 1, 1), 1 };
+		m_StepLaunch = m_InitializeLaunch = launch;
+		m_World = new SimulationWorld(glm::vec3(0.0f), glm::vec3(1.0f), IsHeadless());
 
 		m_World->AddSphere(glm::vec3(0.0f), 0.5f);
 
@@ -33,18 +34,47 @@ namespace Engine
 		m_World->AddSphere(glm::vec3( 0.22f, 0.0f, -0.22f), 0.10f);
 		m_World->AddSphere(glm::vec3(-0.22f, 0.0f, -0.22f), 0.10f);
 
-		Initialize(clKernelFilePath, shaderFilePath);
+		for (SimulationSphere* sphere : m_World->GetSpheres())
+			m_Spheres.push_back(sphere->Sphere);
+		m_ColliderGrid.Build(m_Spheres);
+
+		if (IsCPUBackend())
+			InitializeCPU();
+		else
+			Initialize(clKernelFilePath, shaderFilePath);
 		Reset();
 	}
 
 	ParticleSystem::~ParticleSystem()
 	{
+		Synchronize();
+
+		delete m_Readback;
+		TrackShardEvents({});
+		for (cl_event event : m_SnapshotEvents)
+			clReleaseEvent(event);
+		ReleaseShards();
+		delete m_Partitioner;
+		delete m_CPUSimulation;
+		delete m_World;
+		delete m_CLBoundsPtr;
+		delete m_CLColliderGridPtr;
+		delete m_CLSpawnPtr;
+		delete m_NeighborGrid;
+		delete m_MortonReorder;
+		delete m_RadixSort;
+		for (OpenCLGraph* graph : m_StepGraphs)
+			delete graph;
 		delete m_ParticleProgram;
-		delete m_ParticleColorVBO;
-		delete m_ParticlePositionVBO;
-		delete m_VAO;
+		for (RenderSlot& slot : m_RenderSlots)
+		{
+			delete slot.PreviousPositionVBO;
+			delete slot.ColorVBO;
+			delete slot.PositionVBO;
+			delete slot.VAO;
+		}
 		delete m_ParticlePointShader;
-		delete[] m_SpheresPtr;
+		free(m_SpheresPtr);
 	}
 
 	void ParticleSystem::UpdateBounds()
@@ -59,43 +89,107 @@ namespace Engine
 		glm::vec3 minExtent = bounds.GetMinExtents();
 		cl_float4 min = { minExtent.x, minExtent.y, minExtent.z, 1.0f };
 
-		m_CLBoundsPtr = new cl_simulation_bounds();
 		m_CLBoundsPtr->Center = center;
 		m_CLBoundsPtr->MaxExtent = max;
 		m_CLBoundsPtr->MinExtent = min;
 
-		m_ParticleProgram->WriteToDeviceBufferFromHostBuffer("boundsBuffer", sizeof(cl_simulation_bounds), m_CLBoundsPtr);
+		m_ParticleProgram->WriteToDeviceBufferFromHostBuffer(m_BoundsHandle, sizeof(cl_simulation_bounds), m_CLBoundsPtr);
 	}
 
 	void ParticleSystem::Initialize(const std::string& clKernelFilePath, const std::string& shaderFilePath)
 	{
-		m_ParticlePointShader = new Shader(shaderFilePath);
-		m_VAO = new VertexArray;
-		m_ParticlePositionVBO = new VertexBuffer(m_Properties.PositionDataByteSize);
-		m_ParticlePositionVBO->SetLayout({ {"a_Position", ShaderDataType::Float4} });
-		m_ParticleColorVBO = new VertexBuffer(m_Properties.ColorDataByteSize);
-		m_ParticleColorVBO->SetLayout({ {"a_Color", ShaderDataType::Float4} });
-		m_VAO->AddVertexBuffer(m_ParticlePositionVBO);
-		m_VAO->AddVertexBuffer(m_ParticleColorVBO);
-		m_Velocities.resize(m_Properties.ParticleCount);
-	
-		std::vector<SimulationSphere*> spheres = m_World->GetSpheres();
-		m_SpheresPtr = (cl_float4*)calloc(spheres.size(), sizeof(cl_float4));
-
-		for (int i = 0; i < spheres.size(); ++i)
-		{
-			glm::vec4 sphere = spheres[i]->Sphere;
+		if (!IsHeadless())
+		{
+			m_ParticlePointShader = new Shader(shaderFilePath);
+			m_RenderSlotCount = c_MaxRenderSlots;
+			for (uint32_t i = 0; i < m_RenderSlotCount; i++)
+			{
+				RenderSlot& slot = m_RenderSlots[i];
+				// Attribute locations as in the particle shader; the optional streams keep theirs.
+				slot.VAO = new VertexArray;
+				slot.PositionVBO = new VertexBuffer(m_Properties.PositionDataByteSize);
+				slot.PositionVBO->SetLayout({ {"a_Position", ShaderDataType::Float4} });
+				slot.VAO->AddVertexBuffer(slot.PositionVBO, 0);
+				if (!m_Properties.ShaderColor)
+				{
+					slot.ColorVBO = new VertexBuffer(m_Properties.ColorDataByteSize);
+					slot.ColorVBO->SetLayout({ {"a_Color", ShaderDataType::Float4} });
+					slot.VAO->AddVertexBuffer(slot.ColorVBO, 1);
+				}
+				if (IsInterpolating())
+				{
+					slot.PreviousPositionVBO = new VertexBuffer(m_Properties.PositionDataByteSize);
+					slot.PreviousPositionVBO->SetLayout({ {"a_PreviousPosition", ShaderDataType::Float4} });
+					slot.VAO->AddVertexBuffer(slot.PreviousPositionVBO, 2);
+				}
+			}
+		}
+
+		// Keep at least one entry so the device buffer is never empty; the grid never references it.
+		size_t sphereCount = std::max<size_t>(m_Spheres.size(), 1);
+		m_SpheresPtr = (cl_float4*)calloc(sphereCount, sizeof(cl_float4));
+
+		for (int i = 0; i < m_Spheres.size(); ++i)
+		{
+			glm::vec4 sphere = m_Spheres[i];
 			cl_float4 cl_sphere = { sphere.x, sphere.y, sphere.z, sphere.w };
 			m_SpheresPtr[i] = cl_sphere;
 		}
 
-		m_ParticleProgram =			new OpenCLProgram(clKernelFilePath);
+		const glm::vec3& gridOrigin = m_ColliderGrid.GetOrigin();
+		cl_float4 origin = { gridOrigin.x, gridOrigin.y, gridOrigin.z, 0.0f };
+
+		glm::vec3 gridInvCellSize = 1.0f / m_ColliderGrid.GetCellSize();
+		cl_float4 invCellSize = { gridInvCellSize.x, gridInvCellSize.y, gridInvCellSize.z, 0.0f };
+
+		const glm::ivec3& gridDimensions = m_ColliderGrid.GetDimensions();
+		cl_int4 dimensions = { gridDimensions.x, gridDimensions.y, gridDimensions.z, 0 };
+
+		m_CLColliderGridPtr = new cl_collider_grid();
+		m_CLColliderGridPtr->Origin = origin;
+		m_CLColliderGridPtr->InvCellSize = invCellSize;
+		m_CLColliderGridPtr->Dimensions = dimensions;
+
+		size_t gridCellsSize = sizeof(cl_uint2) * m_ColliderGrid.GetCells().size();
+		size_t gridIndicesSize = sizeof(cl_uint) * m_ColliderGrid.GetIndices().size();
+
+		m_ParticleProgram =			new OpenCLProgram(clKernelFilePath, GetBuildOptions());
+		if (OpenCLContext::IsHostUnifiedMemory())
+			LOG_INFO("OpenCL devices share host memory -- particle buffers are host-visible and mapped instead of copied.");
 		m_CLVelocityBuffer =		new OpenCLBuffer(m_ParticleProgram, "velocityBuffer",	m_Properties.VelocityDataByteSize,	CLBufferType::ReadWrite);
-		m_CLPositionBuffer =		new OpenCLBuffer(m_ParticleProgram, "positionBuffer",	m_Properties.PositionDataByteSize,	CLBufferType::ReadWrite, m_ParticlePositionVBO);
-		m_CLColorBuffer =			new OpenCLBuffer(m_ParticleProgram, "colorBuffer",		m_Properties.ColorDataByteSize,		CLBufferType::ReadWrite, m_ParticleColorVBO);
+		m_CLPositionBuffer =		new OpenCLBuffer(m_ParticleProgram, "positionBuffer",	m_Properties.PositionDataByteSize,	CLBufferType::ReadWrite);
+		if (IsHeadless())
+		{
+			// Nothing is drawn, so the render position aliases the state and the kernels skip it.
+			m_RenderSlots[0].Position = m_RenderSlots[0].PreviousPosition = m_CLPositionBuffer;
+			if (m_Properties.ShaderColor)
+				m_RenderSlots[0].Color = m_CLPositionBuffer;
+			else
+				m_RenderSlots[0].Color =	new OpenCLBuffer(m_ParticleProgram, "colorBuffer",		m_Properties.ColorDataByteSize,		CLBufferType::ReadWrite);
+		}
+		else
+		{
+			for (uint32_t i = 0; i < m_RenderSlotCount; i++)
+			{
+				RenderSlot& slot = m_RenderSlots[i];
+				slot.Position =		new OpenCLBuffer(m_ParticleProgram, "renderPosition" + std::to_string(i),	m_Properties.PositionDataByteSize,	CLBufferType::WriteOnly, slot.PositionVBO);
+				// Without a color stream or interpolation the buffers alias the state and the kernels skip them.
+				if (slot.ColorVBO != nullptr)
+					slot.Color =		new OpenCLBuffer(m_ParticleProgram, "renderColor" + std::to_string(i),		m_Properties.ColorDataByteSize,		CLBufferType::WriteOnly, slot.ColorVBO);
+				else
+					slot.Color = m_CLPositionBuffer;
+				if (slot.PreviousPositionVBO != nullptr)
+					slot.PreviousPosition =	new OpenCLBuffer(m_ParticleProgram, "renderPrevious" + std::to_string(i),	m_Properties.PositionDataByteSize,	CLBufferType::WriteOnly, slot.PreviousPositionVBO);
+				else
+					slot.PreviousPosition = m_CLPositionBuffer;
+			}
+		}
 		m_SimulationBoundsBuffer =	new OpenCLBuffer(m_ParticleProgram, "boundsBuffer",		sizeof(cl_simulation_bounds),		CLBufferType::ReadOnly);
-		m_SpheresBuffer =			new OpenCLBuffer(m_ParticleProgram, "spheresBuffer",	sizeof(cl_float4) * spheres.size(), CLBufferType::ReadOnly);
-		m_TimeBuffer =				new OpenCLBuffer(m_ParticleProgram, "time",				sizeof(cl_float),					CLBufferType::ReadOnly);
+		m_SpheresBuffer =			new OpenCLBuffer(m_ParticleProgram, "spheresBuffer",	sizeof(cl_float4) * sphereCount,	CLBufferType::ReadOnly);
+		m_ColliderGridBuffer =		new OpenCLBuffer(m_ParticleProgram, "colliderGrid",		sizeof(cl_collider_grid),			CLBufferType::ReadOnly);
+		m_ColliderCellsBuffer =		new OpenCLBuffer(m_ParticleProgram, "colliderCells",	gridCellsSize,						CLBufferType::ReadOnly);
+		m_ColliderIndicesBuffer =	new OpenCLBuffer(m_ParticleProgram, "colliderIndices",	gridIndicesSize,					CLBufferType::ReadOnly);
+		m_SpawnBuffer =				new OpenCLBuffer(m_ParticleProgram, "spawnBuffer",		sizeof(cl_particle_spawn),			CLBufferType::ReadOnly);
 
 		const SimulationBounds& bounds = m_World->GetBounds();
 		glm::vec3 boundsCenter = bounds.GetCenter();
@@ -112,87 +206,611 @@ namespace Engine
 		m_CLBoundsPtr->MaxExtent = max;
 		m_CLBoundsPtr->MinExtent = min;
 
-		m_TimePtr = new cl_float;
-		*m_TimePtr = Time::Elapsed();
+		m_Time = Time::Elapsed();
 
 		m_ParticleSimulationKernel = new OpenCLKernel(m_ParticleProgram, "ParticleSimulation",
 			{
 				new KernelArg(m_CLPositionBuffer->GetBufferName(),			m_CLPositionBuffer->GetBufferID(),			OpenCLBuffer::NativeSize(),		KernelArgType::Global),
 				new KernelArg(m_CLVelocityBuffer->GetBufferName(),			m_CLVelocityBuffer->GetBufferID(),			OpenCLBuffer::NativeSize(),		KernelArgType::Global),
-				new KernelArg(m_CLColorBuffer->GetBufferName(),				m_CLColorBuffer->GetBufferID(),				OpenCLBuffer::NativeSize(),		KernelArgType::Global),
+				KernelArg::FromBuffer(m_RenderSlots[0].Position),
+				KernelArg::FromBuffer(m_RenderSlots[0].Color),
 				new KernelArg(m_SimulationBoundsBuffer->GetBufferName(),	m_SimulationBoundsBuffer->GetBufferID(),	OpenCLBuffer::NativeSize(),		KernelArgType::Global),
 				new KernelArg(m_SpheresBuffer->GetBufferName(),				m_SpheresBuffer->GetBufferID(),				OpenCLBuffer::NativeSize(),		KernelArgType::Global),
-				new KernelArg(m_TimeBuffer->GetBufferName(),				m_TimeBuffer->GetBufferID(),				OpenCLBuffer::NativeSize(),		KernelArgType::Global),
+				new KernelArg(m_ColliderGridBuffer->GetBufferName(),		m_ColliderGridBuffer->GetBufferID(),		OpenCLBuffer::NativeSize(),		KernelArgType::Global),
+				new KernelArg(m_ColliderCellsBuffer->GetBufferName(),		m_ColliderCellsBuffer->GetBufferID(),		OpenCLBuffer::NativeSize(),		KernelArgType::Global),
+				new KernelArg(m_ColliderIndicesBuffer->GetBufferName(),		m_ColliderIndicesBuffer->GetBufferID(),		OpenCLBuffer::NativeSize(),		KernelArgType::Global),
+				KernelArg::FromValue("time", &m_Time, sizeof(cl_float)),
+				KernelArg::FromValue("particlesPerItem", &m_StepLaunch.ParticlesPerItem, sizeof(cl_uint)),
+				KernelArg::FromValue("seed", &m_Seed, sizeof(cl_uint)),
+				KernelArg::FromValue("firstPulse", &m_StepFirstPulse, sizeof(cl_uint)),
+				KernelArg::FromValue("pulseCount", &m_StepPulseCount, sizeof(cl_uint)),
+				KernelArg::FromBuffer(m_RenderSlots[0].PreviousPosition),
 			});
 
 		m_ParticleProgram->AddBuffer(m_CLPositionBuffer);
 		m_ParticleProgram->AddBuffer(m_CLVelocityBuffer);
-		m_ParticleProgram->AddBuffer(m_CLColorBuffer);
-		m_ParticleProgram->AddBuffer(m_SimulationBoundsBuffer);
+		for (uint32_t i = 0; i < m_RenderSlotCount; i++)
+		{
+			// Targets aliasing the state are already added and never shared with GL.
+			RenderSlot& slot = m_RenderSlots[i];
+			std::vector<BufferHandle> targets;
+			for (OpenCLBuffer* target : { slot.Position, slot.Color, slot.PreviousPosition })
+				if (target != m_CLPositionBuffer)
+					targets.push_back(m_ParticleProgram->AddBuffer(target));
+			if (!IsHeadless())
+				slot.Targets = m_ParticleProgram->CreateGLObjectSet(targets);
+		}
+		m_BoundsHandle = m_ParticleProgram->AddBuffer(m_SimulationBoundsBuffer);
 		m_ParticleProgram->AddBuffer(m_SpheresBuffer);
-		m_ParticleProgram->AddBuffer(m_TimeBuffer);
-		m_ParticleProgram->AddKernel(m_ParticleSimulationKernel);
+		m_ParticleProgram->AddBuffer(m_ColliderGridBuffer);
+		m_ParticleProgram->AddBuffer(m_ColliderCellsBuffer);
+		m_ParticleProgram->AddBuffer(m_ColliderIndicesBuffer);
+		m_SpawnHandle = m_ParticleProgram->AddBuffer(m_SpawnBuffer);
+		// Reads position and velocity, writes position, velocity and color unless the shader
+		// derives it, plus the render position when drawn and the previous one when interpolating.
+		size_t targetWrites = (m_Properties.ShaderColor ? 0 : 1) + (IsHeadless() ? 0 : (IsInterpolating() ? 2 : 1));
+		m_ParticleSimulationKernel->SetBytesPerWorkItem(sizeof(cl_float4) * (4 + targetWrites));
+		m_SimulationHandle = m_ParticleProgram->AddKernel(m_ParticleSimulationKernel);
 		m_ParticleSimulationKernel->AttachArgs();
 
-		m_ParticleProgram->WriteToDeviceBufferFromHostBuffer("boundsBuffer", sizeof(cl_simulation_bounds), m_CLBoundsPtr);
-		m_ParticleProgram->WriteToDeviceBufferFromHostBuffer("spheresBuffer", sizeof(cl_float4) * spheres.size(), m_SpheresPtr);
-		m_ParticleProgram->WriteToDeviceBufferFromHostBuffer("time", sizeof(cl_float), m_TimePtr);
+		m_ParticleProgram->WriteToDeviceBufferFromHostBuffer(m_BoundsHandle, sizeof(cl_simulation_bounds), m_CLBoundsPtr);
+		m_ParticleProgram->WriteToDeviceBufferFromHostBuffer("spheresBuffer", sizeof(cl_float4) * sphereCount, m_SpheresPtr);
+		m_ParticleProgram->WriteToDeviceBufferFromHostBuffer("colliderGrid", sizeof(cl_collider_grid), m_CLColliderGridPtr);
+		m_ParticleProgram->WriteToDeviceBufferFromHostBuffer("colliderCells", gridCellsSize, (void*)m_ColliderGrid.GetCells().data());
+		m_ParticleProgram->WriteToDeviceBufferFromHostBuffer("colliderIndices", gridIndicesSize, (void*)m_ColliderGrid.GetIndices().data());
 
-		m_PulseKernel = new OpenCLKernel(m_ParticleProgram, "ApplyPulse",
+		m_CLSpawnPtr = new cl_particle_spawn();
+		m_InitializeKernel = new OpenCLKernel(m_ParticleProgram, "InitializeParticles",
 			{
-				new KernelArg(m_CLPositionBuffer->GetBufferName(),			m_CLPositionBuffer->GetBufferID(),			OpenCLBuffer::NativeSize(),		KernelArgType::Global),
-				new KernelArg(m_CLVelocityBuffer->GetBufferName(),			m_CLVelocityBuffer->GetBufferID(),			OpenCLBuffer::NativeSize(),		KernelArgType::Global),
-				new KernelArg(m_SimulationBoundsBuffer->GetBufferName(),	m_SimulationBoundsBuffer->GetBufferID(),	OpenCLBuffer::NativeSize(),		KernelArgType::Global),
+				KernelArg::FromBuffer(m_CLPositionBuffer),
+				KernelArg::FromBuffer(m_CLVelocityBuffer),
+				KernelArg::FromBuffer(m_RenderSlots[0].Position),
+				KernelArg::FromBuffer(m_RenderSlots[0].Color),
+				KernelArg::FromBuffer(m_SpawnBuffer),
+				KernelArg::FromBuffer(m_RenderSlots[0].PreviousPosition),
 			});
 
-		m_ParticleProgram->AddKernel(m_PulseKernel);
-		m_PulseKernel->AttachArgs();
+		// Writes position and velocity, plus the same render targets as the step.
+		m_InitializeKernel->SetBytesPerWorkItem(sizeof(cl_float4) * (2 + targetWrites));
+		m_InitializeHandle = m_ParticleProgram->AddKernel(m_InitializeKernel);
+
+		if (m_Properties.Autotune)
+			Autotune();
+
+		if (m_Properties.MultiDevice)
+			InitializeMultiDevice();
+
+		if (!IsMultiDevice() && (m_Properties.NeighborSearch || m_Properties.ReorderInterval > 0))
+			m_RadixSort = new ParticleRadixSort(m_ParticleProgram, m_Properties.ParticleCount);
+
+		if (!IsMultiDevice() && m_Properties.NeighborSearch)
+			m_NeighborGrid = new NeighborGrid(m_ParticleProgram, m_RadixSort, m_CLPositionBuffer, m_Properties.ParticleCount, bounds.GetMinExtents(), m_Properties.NeighborRadius, m_Properties.NeighborTableBits);
+
+		// Color isn't state: every step rewrites it into the render slot.
+		if (!IsMultiDevice() && m_Properties.ReorderInterval > 0)
+			m_MortonReorder = new MortonReorder(m_ParticleProgram, m_RadixSort, m_CLPositionBuffer, m_SimulationBoundsBuffer, { m_CLPositionBuffer, m_CLVelocityBuffer }, m_Properties.ParticleCount);
+
+		for (uint32_t i = 0; i < m_RenderSlotCount; i++)
+			m_StepGraphs[i] = BuildStepGraph(m_RenderSlots[i]);
+	}
+
+	void ParticleSystem::InitializeMultiDevice()
+	{
+		uint32_t deviceCount = m_ParticleProgram->GetDeviceCount();
+		if (!IsHeadless())
+		{
+			LOG_WARN("Multi-device simulation needs a headless system -- GL sharing keeps the step on one device.");
+			return;
+		}
+		if (deviceCount < 2)
+		{
+			LOG_WARN("Multi-device simulation requested but the OpenCL context has one device -- running on it alone.");
+			return;
+		}
+
+		// Sub-buffers have to start on every device's base address alignment, and each slice must
+		// still be whole work-groups of every particle kernel.
+		size_t alignment = 1;
+		for (cl_device_id device : OpenCLContext::GetDevices())
+		{
+			cl_uint alignBits = 0;
+			clGetDeviceInfo(device, CL_DEVICE_MEM_BASE_ADDR_ALIGN, sizeof(alignBits), &alignBits, NULL);
+			alignment = std::max<size_t>(alignment, alignBits / 8);
+		}
+		size_t alignParticles = std::max<size_t>(alignment / sizeof(cl_float4), 1);
+		size_t granularity = std::lcm(alignParticles, (size_t)m_StepLaunch.Local.x * m_StepLaunch.ParticlesPerItem);
+		granularity = std::lcm(granularity, (size_t)m_InitializeLaunch.Local.x);
+
+		if (m_Properties.ParticleCount % granularity != 0 || m_Properties.ParticleCount < granularity * deviceCount)
+		{
+			LOG_WARN("{} particles can't be split into slices of {} across {} devices -- running on one device.", m_Properties.ParticleCount, granularity, deviceCount);
+			return;
+		}
+
+		if (m_Properties.NeighborSearch)
+			LOG_WARN("Neighbor search needs every particle on one device -- ignored with multi-device simulation.");
+		if (m_Properties.ReorderInterval > 0)
+			LOG_WARN("Morton reordering needs every particle on one device -- ignored with multi-device simulation.");
+
+		m_Partitioner = new DevicePartitioner(m_Properties.ParticleCount, deviceCount, granularity);
+		CreateShards();
+	}
+
+	void ParticleSystem::Autotune()
+	{
+		// Timed on a real spawn so the collision branches behave as they will.  The constructor
+		// resets again afterwards, and the tuning runs stay out of the profiler.  The render
+		// targets stay acquired from the spawn through the last run.
+		const RenderSlot& slot = m_RenderSlots[0];
+		if (!IsHeadless())
+			m_ParticleProgram->AcquireGLObjects(slot.Targets);
+		Reset();
+
+		OpenCLProfiler& profiler = m_ParticleProgram->GetProfiler();
+		bool profiling = profiler.IsEnabled();
+		profiler.SetEnabled(false);
+
+		TuneLaunch(m_SimulationHandle, m_StepLaunch, { 1, 2, 4, 8 });
+		TuneLaunch(m_InitializeHandle, m_InitializeLaunch, { 1 });
+
+		if (!IsHeadless())
+			m_ParticleProgram->ReleaseGLObjects(slot.Targets);
+		m_ParticleProgram->Flush();
+		profiler.SetEnabled(profiling);
+	}
+
+	void ParticleSystem::TuneLaunch(KernelHandle kernelHandle, ParticleLaunch& launch, const std::vector<cl_uint>& particlesPerItem)
+	{
+		OpenCLKernel* kernel = m_ParticleProgram->GetKernel(kernelHandle);
+		size_t count = m_Properties.ParticleCount;
+		uint64_t key = OpenCLAutotuner::ComputeKey(m_ParticleProgram, kernel->GetKernelName(), count);
+
+		KernelTuning tuning;
+		if (!OpenCLAutotuner::Lookup(key, tuning))
+		{
+			std::vector<KernelTuning> candidates;
+			for (cl_uint items : particlesPerItem)
+			{
+				if (count % items != 0)
+					continue;
+				for (uint32_t localSize : OpenCLAutotuner::GetLocalSizeCandidates(kernel->GetID(), count / items))
+					candidates.push_back({ localSize, items });
+			}
+
+			// The step reads its particles per work-item from the launch, so trying a candidate
+			// is just launching with it.
+			ParticleLaunch untuned = launch;
+			tuning = OpenCLAutotuner::Tune(kernel->GetKernelName(), candidates, [&](const KernelTuning& candidate)
+			{
+				launch = { glm::ivec3(count / candidate.ItemsPerWorkItem, 1, 1), glm::ivec3(candidate.LocalSize, 1, 1), candidate.ItemsPerWorkItem };
+				cl_event completion = nullptr;
+				m_ParticleProgram->ExecuteOnDevice(0, kernelHandle, launch.Global, launch.Local, 0, {}, &completion);
+				return completion;
+			});
+			launch = untuned;
+
+			if (!tuning.IsValid())
+				return;
+			OpenCLAutotuner::Store(key, tuning);
+		}
+
+		launch = { glm::ivec3(count / tuning.ItemsPerWorkItem, 1, 1), glm::ivec3(tuning.LocalSize, 1, 1), tuning.ItemsPerWorkItem };
+	}
+
+	void ParticleSystem::CreateShards()
+	{
+		// Slices never overlap, so concurrent writes from different devices are well defined.
+		const size_t elementSize = sizeof(cl_float4);
+		m_Shards.resize(m_Partitioner->GetDeviceCount());
+		for (uint32_t i = 0; i < m_Partitioner->GetDeviceCount(); i++)
+		{
+			const DevicePartitioner::Range& range = m_Partitioner->GetRange(i);
+			std::string suffix = "@" + std::to_string(i);
+			DeviceShard& shard = m_Shards[i];
+			shard.Position =	new OpenCLBuffer(m_ParticleProgram, m_CLPositionBuffer->GetBufferName() + suffix,		m_CLPositionBuffer,			range.Start * elementSize, range.Count * elementSize);
+			shard.Velocity =	new OpenCLBuffer(m_ParticleProgram, m_CLVelocityBuffer->GetBufferName() + suffix,		m_CLVelocityBuffer,			range.Start * elementSize, range.Count * elementSize);
+			if (m_RenderSlots[0].Color != m_CLPositionBuffer)
+				shard.Color =	new OpenCLBuffer(m_ParticleProgram, m_RenderSlots[0].Color->GetBufferName() + suffix,	m_RenderSlots[0].Color,		range.Start * elementSize, range.Count * elementSize);
+		}
+	}
+
+	void ParticleSystem::ReleaseShards()
+	{
+		for (DeviceShard& shard : m_Shards)
+		{
+			delete shard.Position;
+			delete shard.Velocity;
+			delete shard.Color;
+		}
+		m_Shards.clear();
+	}
+
+	void ParticleSystem::DispatchShards(KernelHandle kernelHandle, const ParticleLaunch& launch, bool bindsRenderTargets, std::vector<cl_event>* completions)
+	{
+		OpenCLKernel* kernel = m_ParticleProgram->GetKernel(kernelHandle);
+		// The kernels index their buffers relative to the global offset.  Args are captured at
+		// enqueue, so one kernel object serves every device in turn.
+		for (uint32_t i = 0; i < m_Partitioner->GetDeviceCount(); i++)
+		{
+			const DevicePartitioner::Range& range = m_Partitioner->GetRange(i);
+			const DeviceShard& shard = m_Shards[i];
+			kernel->SetArgData(0, shard.Position->GetBufferID());
+			kernel->SetArgData(1, shard.Velocity->GetBufferID());
+			if (bindsRenderTargets)
+			{
+				// Headless, so the render positions alias the state, as does the color with ShaderColor.
+				kernel->SetArgData(2, shard.Position->GetBufferID());
+				kernel->SetArgData(3, (shard.Color ? shard.Color : shard.Position)->GetBufferID());
+				kernel->SetArgData(kernel->GetArgCount() - 1, shard.Position->GetBufferID());
+			}
+
+			// Snapshots copy the full buffers on the first device's queue, which the other
+			// devices don't order against; none may overwrite its slice before they ran.
+			cl_event completion = nullptr;
+			glm::ivec3 global(range.Count / launch.ParticlesPerItem, 1, 1);
+			m_ParticleProgram->ExecuteOnDevice(i, kernelHandle, global, launch.Local, range.Start, m_SnapshotEvents, completions ? &completion : nullptr);
+			if (completions)
+				completions->push_back(completion);
+		}
+
+		for (cl_event event : m_SnapshotEvents)
+			clReleaseEvent(event);
+		m_SnapshotEvents.clear();
+	}
+
+	void ParticleSystem::Rebalance(const std::vector<cl_event>& completions)
+	{
+		m_ParticleProgram->Flush();
+
+		for (uint32_t i = 0; i < (uint32_t)completions.size(); i++)
+		{
+			cl_ulong start = 0, end = 0;
+			if (completions[i] != nullptr)
+			{
+				clGetEventProfilingInfo(completions[i], CL_PROFILING_COMMAND_START, sizeof(start), &start, NULL);
+				clGetEventProfilingInfo(completions[i], CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL);
+			}
+			if (end > start)
+				m_Partitioner->Sample(i, (end - start) * 1e-9);
+		}
+
+		// Nothing is in flight after the flush, so the shards can be replaced right away.
+		if (m_Partitioner->Rebalance())
+		{
+			ReleaseShards();
+			CreateShards();
+
+			for (uint32_t i = 0; i < m_Partitioner->GetDeviceCount(); i++)
+				LOG_INFO("Device {} now simulates {} particles from {}.", i, m_Partitioner->GetRange(i).Count, m_Partitioner->GetRange(i).Start);
+		}
+	}
+
+	void ParticleSystem::TrackShardEvents(const std::vector<cl_event>& completions)
+	{
+		for (cl_event event : m_ShardEvents)
+			if (event != nullptr)
+				clReleaseEvent(event);
+		m_ShardEvents = completions;
+	}
+
+	OpenCLGraph* ParticleSystem::BuildStepGraph(const RenderSlot& slot)
+	{
+		OpenCLGraph* graph = new OpenCLGraph(m_ParticleProgram, "ParticleStep:" + slot.Position->GetBufferName());
+		std::vector<OpenCLBuffer*> renderTargets;
+		for (OpenCLBuffer* target : { slot.Position, slot.Color, slot.PreviousPosition })
+			if (target != m_CLPositionBuffer)
+				renderTargets.push_back(target);
+
+		if (!IsHeadless())
+			graph->AddAcquire(renderTargets);
+
+		// The reorder runs ahead of the step so the step itself reads the coherent order.
+		// Tick() enables it every ReorderInterval frames.
+		if (m_MortonReorder)
+		{
+			GraphAccess reorderAccess = { { m_CLPositionBuffer, m_SimulationBoundsBuffer }, { m_CLPositionBuffer, m_CLVelocityBuffer, m_RadixSort->GetValueBuffer() } };
+			m_ReorderNode = graph->AddTask("MortonReorder", reorderAccess, [this]() { m_MortonReorder->Reorder(); });
+		}
+
+		GraphAccess stepAccess =
+		{
+			{ m_CLPositionBuffer, m_CLVelocityBuffer, m_SimulationBoundsBuffer, m_SpheresBuffer, m_ColliderGridBuffer, m_ColliderCellsBuffer, m_ColliderIndicesBuffer },
+			{ m_CLPositionBuffer, m_CLVelocityBuffer },
+		};
+		stepAccess.Writes.insert(stepAccess.Writes.end(), renderTargets.begin(), renderTargets.end());
+		// ParticleSimulation takes the render targets as args 2 and 3 and the previous position last.
+		uint32_t previousArg = m_ParticleSimulationKernel->GetArgCount() - 1;
+		graph->AddKernel(m_ParticleSimulationKernel, m_StepLaunch.Global, m_StepLaunch.Local, stepAccess, { { 2, slot.Position }, { 3, slot.Color }, { previousArg, slot.PreviousPosition } });
+
+		if (m_NeighborGrid)
+		{
+			GraphAccess neighborAccess = { { m_CLPositionBuffer }, { m_NeighborGrid->GetCellStartBuffer(), m_NeighborGrid->GetCellEndBuffer(), m_NeighborGrid->GetSortedIndexBuffer() } };
+			graph->AddTask("NeighborGrid", neighborAccess, [this]() { m_NeighborGrid->Build(); });
+		}
+
+		if (!IsHeadless())
+			graph->AddRelease(renderTargets);
+
+		graph->Build();
+		return graph;
+	}
+
+	void ParticleSystem::InitializeCPU()
+	{
+		if (m_Properties.NeighborSearch)
+			LOG_WARN("Neighbor search runs on the OpenCL device only -- ignored by the CPU backend.");
+		if (m_Properties.ReorderInterval > 0)
+			LOG_WARN("Morton reordering runs on the OpenCL device only -- ignored by the CPU backend.");
+
+		m_CPUSimulation = new CPUParticleSimulation(m_Properties.ParticleCount);
+		m_CPUSimulation->SetIntegration(m_Properties.TimeStep, m_Properties.Gravity, std::max<uint32_t>(m_Properties.Substeps, 1));
+	}
+
+	void ParticleSystem::BindRenderSlot(OpenCLKernel* kernel, const RenderSlot& slot)
+	{
+		// InitializeParticles takes the render targets as args 2 and 3 and the previous position last.
+		kernel->SetArgData(2, slot.Position->GetBufferID());
+		kernel->SetArgData(3, slot.Color->GetBufferID());
+		kernel->SetArgData(kernel->GetArgCount() - 1, slot.PreviousPosition->GetBufferID());
+	}
+
+	uint32_t ParticleSystem::AdvanceClock(float dt)
+	{
+		double stepDuration = GetStepDuration();
+		m_Accumulator += std::max(dt, 0.0f);
+
+		// At least one launch, or a cap under the launch duration would stall the simulation.
+		double maxSteps = std::max(std::ceil(m_Properties.MaxTickTime / stepDuration), 1.0);
+		uint32_t steps = (uint32_t)std::min(std::floor(m_Accumulator / stepDuration), maxSteps);
+		m_Accumulator -= steps * stepDuration;
+
+		// What the cap left over is dropped instead of carried, so a frame that fell behind
+		// can't make the next one run more steps, which would make it slower still.
+		if (m_Accumulator >= stepDuration)
+			m_Accumulator = std::fmod(m_Accumulator, stepDuration);
+		return steps;
+	}
+
+	void ParticleSystem::BeginStep()
+	{
+		m_StepCounter++;
+		m_SimulatedTime += GetStepDuration();
+
+		// Pulses queued since the last step are applied by this one.
+		m_StepFirstPulse = m_PulseCount - m_PendingPulses + 1;
+		m_StepPulseCount = m_PendingPulses;
+		m_PendingPulses = 0;
 	}
 
 	void ParticleSystem::Tick(float dt)
 	{
 		if (!m_Start) return;
 
-		*m_TimePtr = Time::Elapsed();
-		m_ParticleProgram->WriteToDeviceBufferFromHostBuffer("time", sizeof(cl_float), m_TimePtr);
+		m_FrameCounter++;
+
+		uint32_t steps = m_Properties.FixedTimestep ? AdvanceClock(dt) : 1;
+
+		if (IsCPUBackend())
+		{
+			for (uint32_t i = 0; i < steps; i++)
+			{
+				BeginStep();
+				m_CPUSimulation->Step(m_World->GetBounds(), m_Spheres, m_ColliderGrid, Time::Elapsed(), m_Seed, m_StepFirstPulse, m_StepPulseCount);
+			}
+			return;
+		}
+
+		m_Time = Time::Elapsed();
+
+		if (IsMultiDevice())
+		{
+			// Each device steps its own slice on its own queue; the slices share nothing they write.
+			for (uint32_t i = 0; i < steps; i++)
+			{
+				BeginStep();
+				bool rebalance = m_Properties.RebalanceInterval > 0 && m_StepCounter % m_Properties.RebalanceInterval == 0;
+				std::vector<cl_event> completions;
+				DispatchShards(m_SimulationHandle, m_StepLaunch, true, &completions);
+				m_ParticleProgram->Submit();
+				if (rebalance)
+					Rebalance(completions);
+				TrackShardEvents(completions);
+			}
+
+			if (m_Readback)
+				m_Readback->Poll();
+			return;
+		}
+
+		if (steps == 0)
+		{
+			// Nothing new to compute.  The shown slot stays, drawn further along as the
+			// accumulator grows, so the drawn time never jumps a step ahead and back.
+			if (m_Readback)
+				m_Readback->Poll();
+			return;
+		}
+
+		RenderSlot& slot = m_RenderSlots[m_WriteSlot];
+		OpenCLGraph* graph = m_StepGraphs[m_WriteSlot];
+
+		// GL must be done drawing the slot before CL writes it.  With cl_khr_gl_event the device
+		// waits on the fence; otherwise the host does, after the previous step is already queued.
+		std::vector<cl_event> drawFinished;
+		if (slot.DrawFence != nullptr)
+		{
+			cl_event fenceEvent = OpenCLContext::CreateEventFromGLFence(slot.DrawFence);
+			if (fenceEvent != nullptr)
+				drawFinished.push_back(fenceEvent);
+			else
+				RenderCommand::WaitFence(slot.DrawFence);
+
+			slot.AcquireFence = slot.DrawFence;
+			slot.DrawFence = nullptr;
+		}
+
+		// Every step of the tick writes the same slot, the last one winning, so drawing
+		// interpolates across the tick's last launch only.  The targets are held across them,
+		// so the graphs' own acquires and releases are only counted.
+		if (!IsHeadless())
+			m_ParticleProgram->AcquireGLObjects(slot.Targets, drawFinished);
+		for (uint32_t i = 0; i < steps; i++)
+		{
+			BeginStep();
+			if (m_MortonReorder)
+				graph->SetEnabled(m_ReorderNode, m_StepCounter % m_Properties.ReorderInterval == 0);
+			graph->Replay();
+		}
+		if (!IsHeadless())
+			m_ParticleProgram->ReleaseGLObjects(slot.Targets, {}, &slot.Released);
+		slot.SimulatedTime = m_SimulatedTime;
+		slot.Time = m_Time;
+
+		// Nothing here waits on the device; Render() waits only for the slot it draws.
+		m_ParticleProgram->Submit();
+
+		if (m_Readback)
+			m_Readback->Poll();
+
+		for (cl_event event : drawFinished)
+			clReleaseEvent(event);
+
+		// Draw the slot finished by the previous step while this one is computed.
+		m_DisplaySlot = m_LastWrittenSlot;
+		m_LastWrittenSlot = m_WriteSlot;
+		m_WriteSlot = (m_WriteSlot + 1) % m_RenderSlotCount;
+	}
+
+	void ParticleSystem::Synchronize()
+	{
+		if (m_ParticleProgram == nullptr)
+			return;
 
-		m_ParticleProgram->EnqueueAcquireGLObjects("positionBuffer");
-		m_ParticleProgram->EnqueueAcquireGLObjects("colorBuffer");
-		m_ParticleProgram->Execute("ParticleSimulation", m_GlobalWorkSize, m_LocalWorkSize, 0);
 		m_ParticleProgram->Flush();
-		m_ParticleProgram->EnqueueReleaseGLObjects("positionBuffer");
-		m_ParticleProgram->EnqueueReleaseGLObjects("colorBuffer");
+		if (m_Readback)
+			m_Readback->Drain();
+
+		for (RenderSlot& slot : m_RenderSlots)
+		{
+			OpenCLContext::WaitForEvent(slot.Released);
+
+			if (slot.DrawFence != nullptr)
+			{
+				RenderCommand::WaitFence(slot.DrawFence);
+				RenderCommand::DeleteFence(slot.DrawFence);
+				slot.DrawFence = nullptr;
+			}
+
+			if (slot.AcquireFence != nullptr)
+			{
+				RenderCommand::DeleteFence(slot.AcquireFence);
+				slot.AcquireFence = nullptr;
+			}
+		}
 	}
 
-	void ParticleSystem::Render(const Camera& camera)
+	uint64_t ParticleSystem::ReadParticles(ParticleAttribute attribute, const ReadbackRange& range, const OpenCLReadback::Callback& callback)
 	{
-		m_VAO->EnableVertexAttributes();
-		m_ParticlePointShader->Bind();
-		m_ParticlePointShader->UploadUniformMat4("u_ViewProjectionMatrix", camera.GetViewProjection());
-		RenderCommand::DrawPoints(m_Properties.ParticleCount);
-		m_World->Render(camera.GetViewProjection());
+		if (IsCPUBackend())
+		{
+			LOG_WARN("Particle readback needs the OpenCL backend.");
+			return 0;
+		}
+
+		if (m_Readback == nullptr)
+			m_Readback = new OpenCLReadback(m_ParticleProgram);
+
+		// The state buffers are CL-only, so no GL objects need acquiring.  With several devices
+		// the slices are written on other queues, which the snapshot has to wait for, and the
+		// next dispatch waits for the snapshot in turn.
+		OpenCLBuffer* buffer = attribute == ParticleAttribute::Position ? m_CLPositionBuffer : m_CLVelocityBuffer;
+		if (!IsMultiDevice())
+			return m_Readback->Request(buffer, sizeof(cl_float4), range, callback);
+
+		cl_event snapshotCopied = nullptr;
+		uint64_t request = m_Readback->Request(buffer, sizeof(cl_float4), range, callback, m_ShardEvents, &snapshotCopied);
+		if (snapshotCopied != nullptr)
+			m_SnapshotEvents.push_back(snapshotCopied);
+		return request;
+	}
+
+	std::string ParticleSystem::GetBuildOptions() const
+	{
+		// Scientific notation always reads back as the same float and always makes a valid literal.
+		char definitions[256];
+		snprintf(definitions, sizeof(definitions), "-D SIM_DT=%.9ef -D SIM_GRAVITY=%.9ef -D SIM_SUBSTEPS=%u -D SIM_SHADER_COLOR=%d -D HAS_COLLIDERS=%d",
+			m_Properties.TimeStep, m_Properties.Gravity, std::max<uint32_t>(m_Properties.Substeps, 1), m_Properties.ShaderColor ? 1 : 0, m_Spheres.empty() ? 0 : 1);
+
+		// Division and sqrt have to round as the host's do for the backends to agree.
+		std::string options = definitions;
+		if (m_Properties.FastMath)
+			options += " -cl-fast-relaxed-math";
+		else if (OpenCLContext::IsCorrectlyRoundedDivideSqrtSupported())
+			options += " -cl-fp32-correctly-rounded-divide-sqrt";
+		if (!m_Properties.BuildOptions.empty())
+			options += " " + m_Properties.BuildOptions;
+		return options;
+	}
+
+	size_t ParticleSystem::GetBytesPerStep() const
+	{
+		// Position and velocity are read and written, color is only written.
+		if (IsCPUBackend())
+			return m_Properties.ParticleCount * sizeof(float) * (3 + 3 + 3 + 3 + 3);
+
+		// Drawn systems also write the position into the render slot, and the previous one when interpolating.
+		size_t renderPositionSize = IsHeadless() ? 0 : m_Properties.PositionDataByteSize * (IsInterpolating() ? 2 : 1);
+		size_t colorSize = m_Properties.ShaderColor ? 0 : m_Properties.ColorDataByteSize;
+		return m_Properties.PositionDataByteSize * 2 + m_Properties.VelocityDataByteSize * 2 + colorSize + renderPositionSize;
 	}
 
-	static float cbrt(float n)
+	float ParticleSystem::GetInterpolationAlpha() const
 	{
-		return std::pow(n, 1 / 3.0);
+		if (!m_Properties.FixedTimestep)
+			return 1.0f;
+
+		// The shown slot spans [SimulatedTime - step, SimulatedTime] and is drawn at
+		// SimulatedTime - step + accumulator, so the latency stays constant and only the
+		// accumulator moves the drawn time within the step.
+		double alpha = m_Accumulator / GetStepDuration();
+		return (float)std::clamp(alpha, 0.0, 1.0);
 	}
 
-	static glm::vec4 PointInSphere(const glm::vec3& center, float radius)
+	void ParticleSystem::Render(const Camera& camera)
 	{
-		float u = Random::RandomRange(0.0f, 1.0f);
-		float v = Random::RandomRange(0.0f, 1.0f);
-		float theta = u * 2.0f * PI;
-		float phi = glm::acos(2.0 * v - 1.0);
-		float r = cbrt(Random::RandomRange(0.0f, 1.0f));
-		float sinTheta = glm::sin(theta);
-		float cosTheta = glm::cos(theta);
-		float sinPhi = glm::sin(phi);
-		float cosPhi = glm::cos(phi);
-		float x = r * sinPhi * cosTheta * radius;
-		float y = r * sinPhi * sinTheta * radius;
-		float z = r * cosPhi * radius;
-		return glm::vec4{ x, y, z, 1.0 };
+		if (IsHeadless()) return;
+
+		RenderSlot& slot = m_RenderSlots[m_DisplaySlot];
+
+		// Submitted a frame ago, so this rarely blocks.
+		OpenCLContext::WaitForEvent(slot.Released);
+		if (slot.AcquireFence != nullptr)
+		{
+			RenderCommand::DeleteFence(slot.AcquireFence);
+			slot.AcquireFence = nullptr;
+		}
+
+		slot.VAO->EnableVertexAttributes();
+		m_ParticlePointShader->Bind();
+		m_ParticlePointShader->UploadUniformMat4("u_ViewProjectionMatrix", camera.GetViewProjection());
+		m_ParticlePointShader->UploadUniformFloat("u_Alpha", IsInterpolating() ? GetInterpolationAlpha() : 1.0f);
+		m_ParticlePointShader->UploadUniformInt("u_ShaderColor", m_Properties.ShaderColor ? 1 : 0);
+		if (m_Properties.ShaderColor)
+		{
+			// The time of the step that wrote the slot, not the newest, so the color matches what
+			// that step's kernel would have written.
+			const SimulationBounds& bounds = m_World->GetBounds();
+			m_ParticlePointShader->UploadUniformFloat3("u_BoundsMin", bounds.GetMinExtents());
+			m_ParticlePointShader->UploadUniformFloat3("u_BoundsMax", bounds.GetMaxExtents());
+			m_ParticlePointShader->UploadUniformFloat("u_Time", slot.Time);
+		}
+		RenderCommand::DrawPoints(m_Properties.ParticleCount);
+
+		if (slot.DrawFence != nullptr)
+			RenderCommand::DeleteFence(slot.DrawFence);
+		slot.DrawFence = RenderCommand::InsertFence();
+
+		m_World->Render(camera.GetViewProjection());
 	}
 
 	void ParticleSystem::Reset()
@@ -200,33 +818,66 @@ namespace Engine
 		m_Start = false;
 		const SimulationBounds& bounds = m_World->GetBounds();
 		float radius = abs(bounds.GetMaxExtents().x - bounds.GetMinExtents().x) / 4.0f - 0.5f;
+		m_Seed = m_Properties.Seed != 0 ? m_Properties.Seed : Random::RandomUInt();
+		m_PulseCount = 0;
+		m_PendingPulses = 0;
+		m_StepPulseCount = 0;
+		m_Accumulator = 0.0;
+		m_SimulatedTime = 0.0;
+
+		if (IsCPUBackend())
+		{
+			m_CPUSimulation->Initialize(bounds.GetCenter(), radius, m_Properties.MinVelocity, m_Properties.MaxVelocity, m_Seed);
+			return;
+		}
 
-		glm::vec4* positions = (glm::vec4*)m_ParticlePositionVBO->MapBuffer(m_Properties.PositionDataByteSize, BufferHint::WriteOnly);
-		for (int i = 0; i < m_Properties.ParticleCount; i++)
-			positions[i] = PointInSphere(bounds.GetCenter(), radius);
-		m_ParticlePositionVBO->UnmapBuffer();
+		// Nothing may still be reading or writing the buffers the spawn overwrites.
+		Synchronize();
 
-		glm::vec4* colors = (glm::vec4*)m_ParticleColorVBO->MapBuffer(m_Properties.ColorDataByteSize, BufferHint::WriteOnly);
-		for (int i = 0; i < m_Properties.ParticleCount; i++)
-			colors[i] = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
-		m_ParticleColorVBO->UnmapBuffer();
+		glm::vec3 spawnCenter = bounds.GetCenter();
+		cl_float4 center = { spawnCenter.x, spawnCenter.y, spawnCenter.z, 1.0f };
+		cl_float4 minVelocity = { m_Properties.MinVelocity.x, m_Properties.MinVelocity.y, m_Properties.MinVelocity.z, 0.0f };
+		cl_float4 maxVelocity = { m_Properties.MaxVelocity.x, m_Properties.MaxVelocity.y, m_Properties.MaxVelocity.z, 0.0f };
 
-		for (int i = 0; i < m_Properties.ParticleCount; i++)
+		m_CLSpawnPtr->Center = center;
+		m_CLSpawnPtr->MinVelocity = minVelocity;
+		m_CLSpawnPtr->MaxVelocity = maxVelocity;
+		m_CLSpawnPtr->Radius = radius;
+		m_CLSpawnPtr->Seed = m_Seed;
+		m_ParticleProgram->WriteToDeviceBufferFromHostBuffer(m_SpawnHandle, sizeof(cl_particle_spawn), m_CLSpawnPtr);
+
+		// The spawn is drawn from the first slot until the first step completes.
+		RenderSlot& slot = m_RenderSlots[0];
+		BindRenderSlot(m_InitializeKernel, slot);
+
+		if (!IsHeadless())
+			m_ParticleProgram->AcquireGLObjects(slot.Targets);
+		if (IsMultiDevice())
 		{
-			m_Velocities[i].x = Random::RandomRange(m_Properties.MinVelocity.x, m_Properties.MaxVelocity.x);
-			m_Velocities[i].y = Random::RandomRange(m_Properties.MinVelocity.y, m_Properties.MaxVelocity.y);
-			m_Velocities[i].z = Random::RandomRange(m_Properties.MinVelocity.z, m_Properties.MaxVelocity.z);
-			m_Velocities[i].w = 0.0f;
+			// The spawn write is on the first device's queue, which the others don't order against.
+			m_ParticleProgram->Flush();
+			DispatchShards(m_InitializeHandle, m_InitializeLaunch, true);
 		}
+		else
+			m_ParticleProgram->Execute(m_InitializeHandle, m_InitializeLaunch.Global, m_InitializeLaunch.Local);
+		if (!IsHeadless())
+			m_ParticleProgram->ReleaseGLObjects(slot.Targets);
+		m_ParticleProgram->Flush();
 
-		m_ParticleProgram->WriteToDeviceBufferFromHostBuffer("velocityBuffer", m_Properties.VelocityDataByteSize, m_Velocities.data());
+		for (RenderSlot& renderSlot : m_RenderSlots)
+		{
+			renderSlot.SimulatedTime = 0.0;
+			renderSlot.Time = m_Time;
+		}
+		m_DisplaySlot = m_LastWrittenSlot = 0;
+		m_WriteSlot = 1 % m_RenderSlotCount;
 	}
 
 	void ParticleSystem::ApplyPulse()
 	{
-		m_ParticleProgram->EnqueueAcquireGLObjects("positionBuffer");
-		m_ParticleProgram->Execute("ApplyPulse", m_GlobalWorkSize, m_LocalWorkSize, 0);
-		m_ParticleProgram->Flush();
-		m_ParticleProgram->EnqueueReleaseGLObjects("positionBuffer");
+		// Each pulse draws a fresh set of numbers for every particle.  Nothing runs until the
+		// next step, which adds every queued pulse to the velocities in the same pass.
+		m_PulseCount++;
+		m_PendingPulses++;
 	}
 }
\ No newline at end of file
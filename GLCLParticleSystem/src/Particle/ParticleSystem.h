@@ -3,10 +3,18 @@
 #include <glm/glm.hpp>
 #include "Particle/SimulationBounds.h"
 #include "Particle/SimulationWorld.h"
+#include "Particle/ColliderGrid.h"
+#include "Particle/NeighborGrid.h"
+#include "Particle/MortonReorder.h"
+#include "Particle/DevicePartitioner.h"
 #include "Engine/Renderer/VertexArray.h"
 #include "Engine/Renderer/Shader.h"
+#include "Engine/Renderer/RenderCommand.h"
 #include "Engine/Compute/OpenCLProgram.h"
+#include "Engine/Compute/OpenCLGraph.h"
+#include "Engine/Compute/OpenCLReadback.h"
 #include "Engine/Renderer/Camera.h"
+#include "Particle/CPUParticleSimulation.h"
 
 #include <OpenCL/cl.h>
 
@@ -19,15 +27,43 @@ namespace Engine
 		cl_float4 MaxExtent;
 	};
 
+	struct cl_collider_grid
+	{
+		cl_float4 Origin;
+		cl_float4 InvCellSize;
+		cl_int4 Dimensions;
+	};
+
+	struct cl_particle_spawn
+	{
+		cl_float4 Center;
+		cl_float4 MinVelocity;
+		cl_float4 MaxVelocity;
+		cl_float Radius;
+		cl_uint Seed;
+		cl_uint Padding[2];
+	};
+
+	enum class SimulationBackend { OpenCL, CPU };
+
+	// Per-particle state that can be read back, one float4 per particle.
+	enum class ParticleAttribute { Position, Velocity };
+
 	struct ParticleSystemProperties
 	{
 		ParticleSystemProperties(
 			size_t particleCount = 1024 * 1024 * 16,
 			const glm::vec3& minVelocity = glm::vec3(-1.0f),
-			const glm::vec3& maxVelocity = glm::vec3(1.0f))
+			const glm::vec3& maxVelocity = glm::vec3(1.0f),
+			SimulationBackend backend = SimulationBackend::OpenCL,
+			size_t maxFrameCount = 1000,
+			bool headless = false,
+			uint32_t localWorkSize = 64)
 			: 
 			ParticleCount(particleCount), 
-			MinVelocity(minVelocity), MaxVelocity(maxVelocity) 
+			MinVelocity(minVelocity), MaxVelocity(maxVelocity),
+			Backend(backend), MaxFrameCount(maxFrameCount),
+			Headless(headless), LocalWorkSize(localWorkSize)
 		{
 		}
 
@@ -38,6 +74,69 @@ namespace Engine
 		size_t ParticleCount;
 		glm::vec3 MinVelocity;
 		glm::vec3 MaxVelocity;
+
+		// The CPU backend runs without an OpenCL device or GL context and is never rendered.
+		SimulationBackend Backend;
+		// Number of ticks after which IsFinished() reports true.  0 runs indefinitely.
+		size_t MaxFrameCount;
+		// Headless OpenCL systems use plain device buffers instead of GL-shared VBOs.
+		bool Headless;
+		uint32_t LocalWorkSize;
+		// Keys every random draw of the simulation.  The same seed reproduces the same run, the
+		// positions and velocities bit for bit, on either backend, given a device that rounds
+		// divide and sqrt correctly and no FastMath.  0 draws a fresh seed on every Reset().
+		uint32_t Seed = 0;
+
+		// Rebuilds a device spatial hash of the particles after every OpenCL step so kernels can
+		// iterate neighbors within NeighborRadius.  Ignored by the CPU backend.
+		bool NeighborSearch = false;
+		float NeighborRadius = 1.0f / 64.0f;
+		uint32_t NeighborTableBits = 22;
+		// Sorts the particle buffers into Morton order of position every ReorderInterval ticks
+		// so spatially close particles share cache lines.  0 disables.  Ignored by the CPU backend.
+		uint32_t ReorderInterval = 0;
+
+		// Integration step and vertical acceleration.  The OpenCL kernels are compiled with them
+		// as constants (SIM_DT, SIM_GRAVITY), so each distinct pair builds its own variant.
+		float TimeStep = 0.00125f;
+		float Gravity = -9.8f * 4.0f;
+		// Integration steps of TimeStep per launch.  The kernel loads each particle once, runs
+		// them all in registers and stores once, so more simulated time per launch costs no extra
+		// memory traffic.  Compiled in as SIM_SUBSTEPS.
+		uint32_t Substeps = 1;
+		// Advances the simulation by the dt passed to Tick() instead of one launch per Tick():
+		// as many launches of TimeStep * Substeps as the elapsed time covers, carrying the rest
+		// over.  Each tick simulates at most MaxTickTime seconds, the cap on launches being sized
+		// from the launch duration, so frame rates down to 1 / MaxTickTime stay in real time.
+		// Slower frames drop the time beyond the cap and the simulation runs slower than real
+		// time rather than each frame getting slower still.  Drawn OpenCL systems interpolate
+		// between the last two states, i.e. across the last launch of a tick, in the vertex
+		// shader, which costs a third render buffer per slot.
+		bool FixedTimestep = false;
+		float MaxTickTime = 1.0f / 20.0f;
+		// Leaves the particle color to the vertex shader, which derives it from the drawn position,
+		// the bounds and the time just as the step would.  The step then neither computes nor
+		// stores it, and no color buffers or VBOs are allocated, a float4 per particle less to
+		// write and to share with GL.  Compiled in as SIM_SHADER_COLOR.  Ignored by the CPU backend.
+		bool ShaderColor = false;
+		// Builds the OpenCL kernels with -cl-fast-relaxed-math, trading IEEE results, and with
+		// them agreement with the CPU backend, for speed.
+		bool FastMath = false;
+		// Appended to the generated OpenCL build options, e.g. further -D definitions.
+		std::string BuildOptions;
+
+		// Splits every OpenCL step across all devices of the context, each simulating a contiguous
+		// slice of the particles.  Needs a headless system and a context created with allDevices;
+		// neighbor search and reordering are ignored.  The split follows the measured speed of
+		// each device, re-measured every RebalanceInterval ticks (0 keeps the even split).
+		bool MultiDevice = false;
+		uint32_t RebalanceInterval = 30;
+
+		// Times the work-group sizes the device prefers, and for the step several particles per
+		// work-item, then launches every OpenCL particle kernel with its fastest shape instead of
+		// LocalWorkSize.  Results are kept in OpenCLAutotuner::GetPath(), so the search runs once
+		// per device, kernel source and particle count.
+		bool Autotune = false;
 	};
 
 	class ParticleSystem
@@ -49,51 +148,191 @@ namespace Engine
 		void Tick(float dt);
 		void Render(const Camera& camera);
 		void Reset();
+		// Queues an upward pulse, which the next Tick() applies as part of its step.  Never blocks.
 		void ApplyPulse();
 		void ToggleRenderSpheres() const { m_World->ToggleRenderSpheres(); }
 		void Start() { m_Start = true; }
+		void Synchronize();
+		// Streams a snapshot of the attribute, as of every step ticked so far, to callback in
+		// chunks.  The copy is queued behind the step and the chunks are called back from later
+		// Tick()s, or Synchronize(), so the simulation never waits on the host.  Returns the
+		// request id, or 0 on the CPU backend.
+		uint64_t ReadParticles(ParticleAttribute attribute, const ReadbackRange& range, const OpenCLReadback::Callback& callback);
 
 		const ParticleSystemProperties& GetProperties() const { return m_Properties; }
-		double GetAverageFrameTime() const { return m_ParticleProgram->GetSumTime() / m_MaxFrameCount * 1000.0f; }
-		bool IsFinished() const { return m_FrameCounter >= m_MaxFrameCount; }
+		uint32_t GetSeed() const { return m_Seed; }
+		bool IsCPUBackend() const { return m_Properties.Backend == SimulationBackend::CPU; }
+		bool IsHeadless() const { return m_Properties.Headless || IsCPUBackend(); }
+		size_t GetBytesPerStep() const;
+		// The step's launch shape, which Autotune may have changed from the properties.
+		uint32_t GetLocalWorkSize() const { return m_StepLaunch.Local.x; }
+		uint32_t GetParticlesPerItem() const { return m_StepLaunch.ParticlesPerItem; }
+		// The clBuildProgram options that specialize particle_sim.cl for these properties.
+		std::string GetBuildOptions() const;
+		NeighborGrid* GetNeighborGrid() const { return m_NeighborGrid; }
+		// The host simulation.  Null on the OpenCL backend.
+		const CPUParticleSimulation* GetCPUSimulation() const { return m_CPUSimulation; }
+		// Device command timings.  Null on the CPU backend.
+		OpenCLProfiler* GetProfiler() const { return IsCPUBackend() ? nullptr : &m_ParticleProgram->GetProfiler(); }
+		double GetSumTime() const { return IsCPUBackend() ? m_CPUSimulation->GetSumTime() : m_ParticleProgram->GetSumTime(); }
+		double GetAverageFrameTime() const { return GetSumTime() / std::max<size_t>(m_FrameCounter, 1) * 1000.0f; }
+		bool IsFinished() const { return m_Properties.MaxFrameCount > 0 && m_FrameCounter >= m_Properties.MaxFrameCount; }
+		// Simulated seconds of one launch.
+		double GetStepDuration() const { return (double)m_Properties.TimeStep * std::max<uint32_t>(m_Properties.Substeps, 1); }
+		// Simulated seconds since the last Reset().
+		double GetSimulatedTime() const { return m_SimulatedTime; }
+		// With FixedTimestep, how far into the next step real time has got, in [0, 1).  Drawn
+		// systems show each state one step late and this far from the previous one towards it.
+		// 1 otherwise.
+		float GetInterpolationAlpha() const;
+
+	private:
+		// One set of render targets.  The simulation state lives in CL-only buffers; each step
+		// also writes its positions and colors into a slot, which GL draws on the following frame
+		// while the next step fills the other slot.
+		struct RenderSlot
+		{
+			VertexArray* VAO = nullptr;
+			VertexBuffer* PositionVBO = nullptr;
+			VertexBuffer* ColorVBO = nullptr;
+			OpenCLBuffer* Position = nullptr;
+			// Aliases the state, and is never written, with ShaderColor.
+			OpenCLBuffer* Color = nullptr;
+			// Where the last launch writing the slot started from.  Only when interpolating.
+			VertexBuffer* PreviousPositionVBO = nullptr;
+			OpenCLBuffer* PreviousPosition = nullptr;
+			// The render targets, acquired and released together.  Empty when headless.
+			GLObjectSet Targets;
+			// Simulated time of the positions in the slot, and the time the step that wrote them
+			// colored by, which the shader colors by with ShaderColor.
+			double SimulatedTime = 0.0;
+			cl_float Time = 0.0f;
+
+			// Signalled when the last draw from this slot finishes; CL waits on it before writing.
+			GLFence DrawFence = nullptr;
+			// The fence the pending acquire waits on, deleted once that acquire is known complete.
+			GLFence AcquireFence = nullptr;
+			// The release closing the step that last wrote this slot; GL waits on it before drawing.
+			cl_event Released = nullptr;
+		};
+
+		static constexpr uint32_t c_MaxRenderSlots = 2;
+
+		// Launch shape of one particle kernel.  Global covers ParticleCount / ParticlesPerItem work-items.
+		struct ParticleLaunch
+		{
+			glm::ivec3 Global;
+			glm::ivec3 Local;
+			cl_uint ParticlesPerItem = 1;
+		};
+
+		// One device's slice of the particle state, as sub-buffers of the full buffers.
+		struct DeviceShard
+		{
+			OpenCLBuffer* Position = nullptr;
+			OpenCLBuffer* Velocity = nullptr;
+			// Null with ShaderColor.
+			OpenCLBuffer* Color = nullptr;
+		};
 
 	private:
 		void UpdateBounds();
 		void Initialize(const std::string& clKernelFilePath, const std::string& shaderFilePath);
+		void InitializeCPU();
+		void BindRenderSlot(OpenCLKernel* kernel, const RenderSlot& slot);
+		OpenCLGraph* BuildStepGraph(const RenderSlot& slot);
+		bool IsMultiDevice() const { return m_Partitioner != nullptr; }
+		bool IsInterpolating() const { return m_Properties.FixedTimestep && !IsHeadless(); }
+		// Adds dt to the accumulator and returns the launches this tick runs.
+		uint32_t AdvanceClock(float dt);
+		// Sets up the value args of the next launch.
+		void BeginStep();
+		void InitializeMultiDevice();
+		// Picks the launch shape of every particle kernel, measuring the ones not tuned before.
+		void Autotune();
+		void TuneLaunch(KernelHandle kernel, ParticleLaunch& launch, const std::vector<cl_uint>& particlesPerItem);
+		void CreateShards();
+		void ReleaseShards();
+		// Enqueues kernel on every device over its slice, after any pending readback snapshots.
+		// Kernels taking render targets get the
+		// slice's position and color as args 2 and 3.  completions, when given, receives one
+		// retained event per device.
+		void DispatchShards(KernelHandle kernel, const ParticleLaunch& launch, bool bindsRenderTargets, std::vector<cl_event>* completions = nullptr);
+		// Feeds the measured device times to the partitioner and rebuilds the shards if it moved.
+		void Rebalance(const std::vector<cl_event>& completions);
+		// Keeps the latest per-device completions, which readbacks of the full buffers wait on.
+		void TrackShardEvents(const std::vector<cl_event>& completions);
 
 	private:
 
 		size_t m_FrameCounter = 0;
-		size_t m_MaxFrameCount = 1000;
+		size_t m_StepCounter = 0;
+		// Real time not yet simulated, under one step unless capped, and simulated time so far.
+		double m_Accumulator = 0.0;
+		double m_SimulatedTime = 0.0;
+		cl_uint m_Seed = 0;
+		cl_uint m_PulseCount = 0;
+		// Pulses queued since the last step, and the range the current step applies.
+		cl_uint m_PendingPulses = 0;
+		cl_uint m_StepFirstPulse = 1;
+		cl_uint m_StepPulseCount = 0;
 		bool m_Start = false;
-		cl_float* m_TimePtr;
-		cl_float4* m_SpheresPtr;
-		cl_simulation_bounds* m_CLBoundsPtr;
+		cl_float m_Time = 0.0f;
+		cl_float4* m_SpheresPtr = nullptr;
+		cl_simulation_bounds* m_CLBoundsPtr = nullptr;
+		cl_collider_grid* m_CLColliderGridPtr = nullptr;
+		cl_particle_spawn* m_CLSpawnPtr = nullptr;
 
 		SimulationWorld* m_World;
-		Shader* m_ParticlePointShader;
-		VertexArray* m_VAO;
-		OpenCLProgram* m_ParticleProgram;
+		Shader* m_ParticlePointShader = nullptr;
+		OpenCLProgram* m_ParticleProgram = nullptr;
 		OpenCLBuffer* m_CLVelocityBuffer;
 		OpenCLBuffer* m_CLPositionBuffer;
-		OpenCLBuffer* m_CLColorBuffer;
 		OpenCLBuffer* m_SimulationBoundsBuffer;
 		OpenCLBuffer* m_SpheresBuffer;
-		OpenCLBuffer* m_TimeBuffer;
+		OpenCLBuffer* m_ColliderGridBuffer;
+		OpenCLBuffer* m_ColliderCellsBuffer;
+		OpenCLBuffer* m_ColliderIndicesBuffer;
+		OpenCLBuffer* m_SpawnBuffer;
 		OpenCLKernel* m_ParticleSimulationKernel;
 
-		OpenCLKernel* m_PulseKernel;
+		OpenCLKernel* m_InitializeKernel;
 
+		// Resolved when the kernels and buffers are added, for the per-frame calls.
+		KernelHandle m_SimulationHandle;
+		KernelHandle m_InitializeHandle;
+		BufferHandle m_BoundsHandle;
+		BufferHandle m_SpawnHandle;
+
+		ParticleRadixSort* m_RadixSort = nullptr;
+		NeighborGrid* m_NeighborGrid = nullptr;
+		MortonReorder* m_MortonReorder = nullptr;
+		CPUParticleSimulation* m_CPUSimulation = nullptr;
+		std::vector<glm::vec4> m_Spheres;
+		ColliderGrid m_ColliderGrid;
 
 		float m_RotationSpeed = 1.0f;
 
-		glm::ivec3 m_GlobalWorkSize;
-		glm::ivec3 m_LocalWorkSize;
-		const size_t c_ThreadsPerWorkGroup = 64;
+		ParticleLaunch m_StepLaunch;
+		ParticleLaunch m_InitializeLaunch;
+
+		RenderSlot m_RenderSlots[c_MaxRenderSlots];
+		// One recorded step per render slot, replayed by Tick().
+		OpenCLGraph* m_StepGraphs[c_MaxRenderSlots] = {};
+		OpenCLGraph::NodeID m_ReorderNode = 0;
+		uint32_t m_RenderSlotCount = 1;
+		uint32_t m_WriteSlot = 0;
+		uint32_t m_LastWrittenSlot = 0;
+		uint32_t m_DisplaySlot = 0;
+
+		DevicePartitioner* m_Partitioner = nullptr;
+		std::vector<DeviceShard> m_Shards;
+		std::vector<cl_event> m_ShardEvents;
+		// Snapshot copies requested since the last dispatch, which the next one waits on.
+		std::vector<cl_event> m_SnapshotEvents;
 
-		VertexBuffer* m_ParticlePositionVBO;
-		VertexBuffer* m_ParticleColorVBO;
-		std::vector<glm::vec4> m_Velocities;
+		// Created by the first ReadParticles().
+		OpenCLReadback* m_Readback = nullptr;
 
 		ParticleSystemProperties m_Properties;
 	};
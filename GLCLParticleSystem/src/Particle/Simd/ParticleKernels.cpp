@@ -0,0 +1,82 @@
+#include "glclpch.h"
+#include "Particle/Simd/ParticleKernels.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Engine
+{
+#if defined(_MSC_VER)
+	bool ParticleKernels::IsSupported(SimdISA isa)
+	{
+		int info[4];
+		__cpuid(info, 1);
+		bool sse41 = (info[2] & (1 << 19)) != 0;
+		bool fma = (info[2] & (1 << 12)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+
+		unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+		bool osAVX = (xcr0 & 0x6) == 0x6;
+		bool osAVX512 = (xcr0 & 0xE6) == 0xE6;
+
+		__cpuidex(info, 7, 0);
+		bool avx2 = (info[1] & (1 << 5)) != 0;
+		bool avx512f = (info[1] & (1 << 16)) != 0;
+
+		switch (isa)
+		{
+		case SimdISA::SSE4: return sse41;
+		case SimdISA::AVX2: return avx && avx2 && fma && osAVX;
+		case SimdISA::AVX512: return avx512f && osAVX512;
+		}
+		return true;
+	}
+#else
+	bool ParticleKernels::IsSupported(SimdISA isa)
+	{
+		__builtin_cpu_init();
+
+		switch (isa)
+		{
+		case SimdISA::SSE4: return __builtin_cpu_supports("sse4.1");
+		case SimdISA::AVX2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+		case SimdISA::AVX512: return __builtin_cpu_supports("avx512f");
+		}
+		return true;
+	}
+#endif
+
+	SimdISA ParticleKernels::DetectISA()
+	{
+		if (IsSupported(SimdISA::AVX512)) return SimdISA::AVX512;
+		if (IsSupported(SimdISA::AVX2)) return SimdISA::AVX2;
+		if (IsSupported(SimdISA::SSE4)) return SimdISA::SSE4;
+		return SimdISA::Scalar;
+	}
+
+	IntegrateRangeFn ParticleKernels::Select(SimdISA isa)
+	{
+		switch (isa)
+		{
+		case SimdISA::AVX512: return IntegrateRange_AVX512;
+		case SimdISA::AVX2: return IntegrateRange_AVX2;
+		case SimdISA::SSE4: return IntegrateRange_SSE4;
+		}
+
+		return IntegrateRange_Scalar;
+	}
+
+	const char* ParticleKernels::ISAName(SimdISA isa)
+	{
+		switch (isa)
+		{
+		case SimdISA::AVX512: return "AVX-512";
+		case SimdISA::AVX2: return "AVX2";
+		case SimdISA::SSE4: return "SSE4.1";
+		}
+
+		return "Scalar";
+	}
+}
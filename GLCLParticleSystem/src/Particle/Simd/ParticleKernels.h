@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace Engine
+{
+	// Structure-of-arrays view of the CPU particle state.  One float per lane, no padding.
+	struct ParticleStreams
+	{
+		float* PositionX;
+		float* PositionY;
+		float* PositionZ;
+		float* VelocityX;
+		float* VelocityY;
+		float* VelocityZ;
+		float* ColorR;
+		float* ColorG;
+		float* ColorB;
+	};
+
+	struct ParticleStepParams
+	{
+		float MinExtent[3];
+		float MaxExtent[3];
+		float ColumnMin[3];
+		float ColumnMax[3];
+
+		// Indexed by sphere id.
+		const float* SphereX;
+		const float* SphereY;
+		const float* SphereZ;
+		const float* SphereRadiusSquared;
+
+		// ColliderGrid: (first, count) pairs per cell into GridIndices, which holds sphere ids.
+		float GridOrigin[3];
+		float GridInvCellSize[3];
+		int32_t GridDimensions[3];
+		const uint32_t* GridCells;
+		const uint32_t* GridIndices;
+
+		float Time;
+		float TimeStep;
+		float Gravity;
+		// Steps of TimeStep taken per call, with the particles kept in registers between them.
+		uint32_t Substeps = 1;
+
+		// Pulses FirstPulse to FirstPulse + PulseCount - 1 are added to the y velocity before the
+		// first substep, as in the ParticleSimulation kernel.  BoundsSize is the pulse's reach.
+		uint32_t Seed = 0;
+		uint32_t FirstPulse = 0;
+		uint32_t PulseCount = 0;
+		float BoundsSize = 1.0f;
+	};
+
+	enum class SimdISA { Scalar = 0, SSE4, AVX2, AVX512 };
+
+	using IntegrateRangeFn = void(*)(const ParticleStreams& streams, const ParticleStepParams& params, size_t begin, size_t end);
+
+	class ParticleKernels
+	{
+	public:
+		// Every variant produces the same bits, so the widest supported one is always safe to pick.
+		static bool IsSupported(SimdISA isa);
+		static SimdISA DetectISA();
+		static IntegrateRangeFn Select(SimdISA isa);
+		static const char* ISAName(SimdISA isa);
+	};
+
+	void IntegrateRange_Scalar(const ParticleStreams& streams, const ParticleStepParams& params, size_t begin, size_t end);
+	void IntegrateRange_SSE4(const ParticleStreams& streams, const ParticleStepParams& params, size_t begin, size_t end);
+	void IntegrateRange_AVX2(const ParticleStreams& streams, const ParticleStepParams& params, size_t begin, size_t end);
+	void IntegrateRange_AVX512(const ParticleStreams& streams, const ParticleStepParams& params, size_t begin, size_t end);
+}
@@ -0,0 +1,291 @@
+#pragma once
+
+// Width-generic integrate/collide/bounce step shared by every ISA translation unit.
+// Each ParticleKernels_*.cpp defines an Ops struct wrapping its intrinsics and then
+// instantiates IntegrateRange<Ops>.  Everything here has internal linkage so that the
+// copies compiled with different target flags can never be merged by the linker.
+// Every Ops rounds alike: MulAdd is a multiply and then an add, never fused, and the
+// translation units are built without fp contraction, so each ISA steps to the same bits.
+
+#include "Particle/Simd/ParticleKernels.h"
+#include "Engine/Philox.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Engine
+{
+	namespace
+	{
+		constexpr float c_TwoPi = 6.28318530718f;
+		constexpr float c_InvTwoPi = 0.15915494309f;
+		// As RNG_STREAM_PULSE in particle_sim.cl.
+		constexpr uint32_t c_StreamPulse = 2;
+		constexpr float c_PulseMaxForce = 50.0f;
+
+		// Philox::Uniform4(seed, particle, pulse, c_StreamPulse).x, restated here so it gets internal
+		// linkage too: the inline original could be merged with a copy built for a wider ISA.
+		inline float PulseUniform(uint32_t seed, uint32_t particle, uint32_t pulse)
+		{
+			uint32_t c0 = particle, c1 = pulse, c2 = c_StreamPulse, c3 = 0;
+			uint32_t k0 = seed, k1 = 0;
+			for (int round = 0; round < 10; round++)
+			{
+				if (round > 0)
+				{
+					k0 += Philox::c_W0;
+					k1 += Philox::c_W1;
+				}
+				uint64_t product0 = (uint64_t)Philox::c_M0 * c0;
+				uint64_t product1 = (uint64_t)Philox::c_M1 * c2;
+				c0 = (uint32_t)(product1 >> 32) ^ c1 ^ k0;
+				c1 = (uint32_t)product1;
+				c2 = (uint32_t)(product0 >> 32) ^ c3 ^ k1;
+				c3 = (uint32_t)product0;
+			}
+			return (float)(c0 >> 8) * (1.0f / 16777216.0f);
+		}
+
+		// Even Taylor series on [-pi, pi] after reduction.  Plenty for a color ramp.
+		template<typename Ops>
+		inline typename Ops::F Cos(typename Ops::F x)
+		{
+			using F = typename Ops::F;
+
+			F turns = Ops::Mul(x, Ops::Set1(c_InvTwoPi));
+			turns = Ops::Sub(turns, Ops::Round(turns));
+			F r = Ops::Mul(turns, Ops::Set1(c_TwoPi));
+			F r2 = Ops::Mul(r, r);
+
+			F c = Ops::Set1(1.0f / 20922789888000.0f);
+			c = Ops::MulAdd(c, r2, Ops::Set1(-1.0f / 87178291200.0f));
+			c = Ops::MulAdd(c, r2, Ops::Set1(1.0f / 479001600.0f));
+			c = Ops::MulAdd(c, r2, Ops::Set1(-1.0f / 3628800.0f));
+			c = Ops::MulAdd(c, r2, Ops::Set1(1.0f / 40320.0f));
+			c = Ops::MulAdd(c, r2, Ops::Set1(-1.0f / 720.0f));
+			c = Ops::MulAdd(c, r2, Ops::Set1(1.0f / 24.0f));
+			c = Ops::MulAdd(c, r2, Ops::Set1(-1.0f / 2.0f));
+			c = Ops::MulAdd(c, r2, Ops::Set1(1.0f));
+			return c;
+		}
+
+		// -1 outside the grid, which also means outside every sphere.  Written so NaN lands outside too.
+		inline int32_t ColliderCell(const ParticleStepParams& params, float x, float y, float z)
+		{
+			float cx = (x - params.GridOrigin[0]) * params.GridInvCellSize[0];
+			float cy = (y - params.GridOrigin[1]) * params.GridInvCellSize[1];
+			float cz = (z - params.GridOrigin[2]) * params.GridInvCellSize[2];
+
+			if (!(cx >= 0.0f && cx < params.GridDimensions[0] && cy >= 0.0f && cy < params.GridDimensions[1] && cz >= 0.0f && cz < params.GridDimensions[2]))
+				return -1;
+
+			return ((int32_t)cz * params.GridDimensions[1] + (int32_t)cy) * params.GridDimensions[0] + (int32_t)cx;
+		}
+
+		template<typename Ops>
+		inline void IntegrateBlock(const ParticleStreams& s, const ParticleStepParams& params, size_t i)
+		{
+			using F = typename Ops::F;
+			using M = typename Ops::M;
+
+			const F dt = Ops::Set1(params.TimeStep);
+			const F halfGdt2 = Ops::Set1(0.5f * params.Gravity * params.TimeStep * params.TimeStep);
+			const F zero = Ops::Set1(0.0f);
+
+			F px = Ops::Load(s.PositionX + i);
+			F py = Ops::Load(s.PositionY + i);
+			F pz = Ops::Load(s.PositionZ + i);
+			F vx = Ops::Load(s.VelocityX + i);
+			F vy = Ops::Load(s.VelocityY + i);
+			F vz = Ops::Load(s.VelocityZ + i);
+
+			// Queued pulses, as PulseImpulse in particle_sim.cl.  The bottom center has x = z = 0, so
+			// px and pz are already the kernel's offset from it.  Only the random draw varies per pulse.
+			if (params.PulseCount > 0)
+			{
+				const F size = Ops::Set1(params.BoundsSize);
+				F dy = Ops::Sub(py, Ops::Set1(params.MinExtent[1]));
+				F forcePercent = Ops::Div(Ops::Sub(size, Ops::Sqrt(Ops::MulAdd(px, px, Ops::MulAdd(dy, dy, Ops::Mul(pz, pz))))), size);
+				F yEffect = Ops::Div(Ops::Sub(Ops::Set1(params.MaxExtent[1]), py), size);
+				F force = Ops::Mul(Ops::Mul(Ops::Mul(Ops::Mul(Ops::Set1(c_PulseMaxForce), forcePercent), forcePercent), yEffect), yEffect);
+
+				for (uint32_t pulse = params.FirstPulse; pulse < params.FirstPulse + params.PulseCount; pulse++)
+				{
+					float r[Ops::Width];
+					for (size_t lane = 0; lane < Ops::Width; lane++)
+						r[lane] = PulseUniform(params.Seed, (uint32_t)(i + lane), pulse);
+					vy = Ops::Add(vy, Ops::Mul(force, Ops::Load(r)));
+				}
+			}
+
+			// Every substep stays in registers; memory is touched once per call.  Color follows the
+			// position at the start of the last substep.
+			const F one = Ops::Set1(1.0f);
+			const F minusOne = Ops::Set1(-1.0f);
+			F sx = px, sy = py, sz = pz;
+			for (uint32_t substep = 0; substep < params.Substeps; substep++)
+			{
+				sx = px;
+				sy = py;
+				sz = pz;
+
+				// Predicted position and velocity after gravity.
+				F ppx = Ops::MulAdd(vx, dt, px);
+				F ppy = Ops::Add(Ops::MulAdd(vy, dt, py), halfGdt2);
+				F ppz = Ops::MulAdd(vz, dt, pz);
+				F vgy = Ops::Add(vy, Ops::Set1(params.Gravity * params.TimeStep));
+
+				// Falling particles inside the center column pass through untouched.
+				M inColumn = Ops::And(
+					Ops::And(Ops::And(Ops::Ge(ppx, Ops::Set1(params.ColumnMin[0])), Ops::Le(ppx, Ops::Set1(params.ColumnMax[0]))),
+							 Ops::And(Ops::Ge(ppy, Ops::Set1(params.ColumnMin[1])), Ops::Le(ppy, Ops::Set1(params.ColumnMax[1])))),
+					Ops::And(Ops::Ge(ppz, Ops::Set1(params.ColumnMin[2])), Ops::Le(ppz, Ops::Set1(params.ColumnMax[2]))));
+				M resolved = Ops::And(inColumn, Ops::Lt(vgy, zero));
+				M hit = Ops::False();
+
+				F nx = zero;
+				F ny = Ops::Set1(1.0f);
+				F nz = zero;
+
+				// Only the spheres listed in a lane's grid cell can contain it.  Neighbouring particles
+				// usually share a cell, so each distinct cell in the block is walked once under a mask.
+				float cellIds[Ops::Width];
+				{
+					float lx[Ops::Width], ly[Ops::Width], lz[Ops::Width];
+					Ops::Store(lx, ppx);
+					Ops::Store(ly, ppy);
+					Ops::Store(lz, ppz);
+					for (size_t lane = 0; lane < Ops::Width; lane++)
+						cellIds[lane] = (float)ColliderCell(params, lx[lane], ly[lane], lz[lane]);
+				}
+
+				const F laneCells = Ops::Load(cellIds);
+				for (size_t lane = 0; lane < Ops::Width; lane++)
+				{
+					float cell = cellIds[lane];
+					if (cell < 0.0f || std::find(cellIds, cellIds + lane, cell) != cellIds + lane)
+						continue;
+
+					M inCell = Ops::Eq(laneCells, Ops::Set1(cell));
+					const uint32_t* range = params.GridCells + (size_t)cell * 2;
+
+					// Cell lists are ascending, so the first sphere containing the particle wins,
+					// matching the kernel's early return.
+					for (uint32_t entry = range[0]; entry < range[0] + range[1]; entry++)
+					{
+						uint32_t sphere = params.GridIndices[entry];
+						F dx = Ops::Sub(ppx, Ops::Set1(params.SphereX[sphere]));
+						F dy = Ops::Sub(ppy, Ops::Set1(params.SphereY[sphere]));
+						F dz = Ops::Sub(ppz, Ops::Set1(params.SphereZ[sphere]));
+						F d2 = Ops::MulAdd(dx, dx, Ops::MulAdd(dy, dy, Ops::Mul(dz, dz)));
+
+						M inside = Ops::And(inCell, Ops::AndNot(Ops::Or(resolved, hit), Ops::Lt(d2, Ops::Set1(params.SphereRadiusSquared[sphere]))));
+						nx = Ops::Select(inside, dx, nx);
+						ny = Ops::Select(inside, dy, ny);
+						nz = Ops::Select(inside, dz, nz);
+						hit = Ops::Or(hit, inside);
+					}
+				}
+
+				// Bounds faces in the kernel's priority order: -y, +y, -x, +x, -z, +z.
+				const M faces[6] =
+				{
+					Ops::Lt(ppy, Ops::Set1(params.MinExtent[1])),
+					Ops::Gt(ppy, Ops::Set1(params.MaxExtent[1])),
+					Ops::Lt(ppx, Ops::Set1(params.MinExtent[0])),
+					Ops::Gt(ppx, Ops::Set1(params.MaxExtent[0])),
+					Ops::Lt(ppz, Ops::Set1(params.MinExtent[2])),
+					Ops::Gt(ppz, Ops::Set1(params.MaxExtent[2])),
+				};
+
+				for (int face = 0; face < 6; face++)
+				{
+					M take = Ops::AndNot(Ops::Or(resolved, hit), faces[face]);
+					F sign = (face & 1) ? minusOne : one;
+					nx = Ops::Select(take, face / 2 == 1 ? sign : zero, nx);
+					ny = Ops::Select(take, face / 2 == 0 ? sign : zero, ny);
+					nz = Ops::Select(take, face / 2 == 2 ? sign : zero, nz);
+					hit = Ops::Or(hit, take);
+				}
+
+				// r = i - 2 dot(i, n) n with both vectors normalized.
+				F invI = Ops::Div(one, Ops::Sqrt(Ops::MulAdd(vx, vx, Ops::MulAdd(vgy, vgy, Ops::Mul(vz, vz)))));
+				F invN = Ops::Div(one, Ops::Sqrt(Ops::MulAdd(nx, nx, Ops::MulAdd(ny, ny, Ops::Mul(nz, nz)))));
+				F ix = Ops::Mul(vx, invI), iy = Ops::Mul(vgy, invI), iz = Ops::Mul(vz, invI);
+				nx = Ops::Mul(nx, invN); ny = Ops::Mul(ny, invN); nz = Ops::Mul(nz, invN);
+				F twoDot = Ops::Mul(Ops::Set1(2.0f), Ops::MulAdd(ix, nx, Ops::MulAdd(iy, ny, Ops::Mul(iz, nz))));
+
+				F vpx = Ops::Select(hit, Ops::Sub(ix, Ops::Mul(nx, twoDot)), vx);
+				F vpy = Ops::Select(hit, Ops::Sub(iy, Ops::Mul(ny, twoDot)), vgy);
+				F vpz = Ops::Select(hit, Ops::Sub(iz, Ops::Mul(nz, twoDot)), vz);
+
+				px = Ops::MulAdd(vpx, dt, px);
+				py = Ops::Add(Ops::MulAdd(vpy, dt, py), halfGdt2);
+				pz = Ops::MulAdd(vpz, dt, pz);
+				vx = vpx;
+				vy = vpy;
+				vz = vpz;
+			}
+
+			F rx = Ops::Mul(Ops::Sub(sx, Ops::Set1(params.MinExtent[0])), Ops::Set1(1.0f / (params.MaxExtent[0] - params.MinExtent[0])));
+			F ry = Ops::Mul(Ops::Sub(sy, Ops::Set1(params.MinExtent[1])), Ops::Set1(1.0f / (params.MaxExtent[1] - params.MinExtent[1])));
+			F rz = Ops::Mul(Ops::Sub(sz, Ops::Set1(params.MinExtent[2])), Ops::Set1(1.0f / (params.MaxExtent[2] - params.MinExtent[2])));
+			F time = Ops::Set1(params.Time);
+			F half = Ops::Set1(0.5f);
+
+			F cr = Ops::MulAdd(half, Cos<Ops>(Ops::Add(time, rx)), half);
+			F cg = Ops::MulAdd(half, Cos<Ops>(Ops::Add(time, Ops::Add(ry, Ops::Set1(2.0f)))), half);
+			F cb = Ops::MulAdd(half, Cos<Ops>(Ops::Add(time, Ops::Add(rz, Ops::Set1(4.0f)))), half);
+
+			Ops::Store(s.ColorR + i, Ops::MulAdd(Ops::Sub(zero, cr), ry, cr));
+			Ops::Store(s.ColorG + i, Ops::MulAdd(Ops::Sub(one, cg), ry, cg));
+			Ops::Store(s.ColorB + i, Ops::MulAdd(Ops::Sub(zero, cb), ry, cb));
+
+			Ops::Store(s.PositionX + i, px);
+			Ops::Store(s.PositionY + i, py);
+			Ops::Store(s.PositionZ + i, pz);
+			Ops::Store(s.VelocityX + i, vx);
+			Ops::Store(s.VelocityY + i, vy);
+			Ops::Store(s.VelocityZ + i, vz);
+		}
+
+		struct ScalarOps
+		{
+			using F = float;
+			using M = bool;
+			static constexpr size_t Width = 1;
+
+			static F Load(const float* p) { return *p; }
+			static void Store(float* p, F v) { *p = v; }
+			static F Set1(float v) { return v; }
+			static F Add(F a, F b) { return a + b; }
+			static F Sub(F a, F b) { return a - b; }
+			static F Mul(F a, F b) { return a * b; }
+			static F Div(F a, F b) { return a / b; }
+			static F MulAdd(F a, F b, F c) { return a * b + c; }
+			static F Sqrt(F a) { return std::sqrt(a); }
+			static F Round(F a) { return std::nearbyint(a); }
+			static M Lt(F a, F b) { return a < b; }
+			static M Gt(F a, F b) { return a > b; }
+			static M Le(F a, F b) { return a <= b; }
+			static M Ge(F a, F b) { return a >= b; }
+			static M Eq(F a, F b) { return a == b; }
+			static M And(M a, M b) { return a && b; }
+			static M Or(M a, M b) { return a || b; }
+			static M AndNot(M a, M b) { return !a && b; }
+			static M False() { return false; }
+			static F Select(M m, F a, F b) { return m ? a : b; }
+		};
+
+		template<typename Ops>
+		inline void IntegrateRange(const ParticleStreams& streams, const ParticleStepParams& params, size_t begin, size_t end)
+		{
+			size_t i = begin;
+			for (; i + Ops::Width <= end; i += Ops::Width)
+				IntegrateBlock<Ops>(streams, params, i);
+
+			for (; i < end; i++)
+				IntegrateBlock<ScalarOps>(streams, params, i);
+		}
+	}
+}
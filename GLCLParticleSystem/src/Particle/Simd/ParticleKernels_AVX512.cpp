@@ -0,0 +1,42 @@
+#include "Particle/Simd/ParticleKernelsImpl.h"
+
+#include <immintrin.h>
+
+namespace Engine
+{
+	namespace
+	{
+		struct AVX512Ops
+		{
+			using F = __m512;
+			using M = __mmask16;
+			static constexpr size_t Width = 16;
+
+			static F Load(const float* p) { return _mm512_loadu_ps(p); }
+			static void Store(float* p, F v) { _mm512_storeu_ps(p, v); }
+			static F Set1(float v) { return _mm512_set1_ps(v); }
+			static F Add(F a, F b) { return _mm512_add_ps(a, b); }
+			static F Sub(F a, F b) { return _mm512_sub_ps(a, b); }
+			static F Mul(F a, F b) { return _mm512_mul_ps(a, b); }
+			static F Div(F a, F b) { return _mm512_div_ps(a, b); }
+			static F MulAdd(F a, F b, F c) { return _mm512_add_ps(_mm512_mul_ps(a, b), c); }
+			static F Sqrt(F a) { return _mm512_sqrt_ps(a); }
+			static F Round(F a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+			static M Lt(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+			static M Gt(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+			static M Le(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+			static M Ge(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+			static M Eq(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+			static M And(M a, M b) { return (M)(a & b); }
+			static M Or(M a, M b) { return (M)(a | b); }
+			static M AndNot(M a, M b) { return (M)(~a & b); }
+			static M False() { return 0; }
+			static F Select(M m, F a, F b) { return _mm512_mask_blend_ps(m, b, a); }
+		};
+	}
+
+	void IntegrateRange_AVX512(const ParticleStreams& streams, const ParticleStepParams& params, size_t begin, size_t end)
+	{
+		IntegrateRange<AVX512Ops>(streams, params, begin, end);
+	}
+}
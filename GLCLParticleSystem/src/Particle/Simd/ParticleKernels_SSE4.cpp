@@ -0,0 +1,42 @@
+#include "Particle/Simd/ParticleKernelsImpl.h"
+
+#include <smmintrin.h>
+
+namespace Engine
+{
+	namespace
+	{
+		struct SSE4Ops
+		{
+			using F = __m128;
+			using M = __m128;
+			static constexpr size_t Width = 4;
+
+			static F Load(const float* p) { return _mm_loadu_ps(p); }
+			static void Store(float* p, F v) { _mm_storeu_ps(p, v); }
+			static F Set1(float v) { return _mm_set1_ps(v); }
+			static F Add(F a, F b) { return _mm_add_ps(a, b); }
+			static F Sub(F a, F b) { return _mm_sub_ps(a, b); }
+			static F Mul(F a, F b) { return _mm_mul_ps(a, b); }
+			static F Div(F a, F b) { return _mm_div_ps(a, b); }
+			static F MulAdd(F a, F b, F c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+			static F Sqrt(F a) { return _mm_sqrt_ps(a); }
+			static F Round(F a) { return _mm_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+			static M Lt(F a, F b) { return _mm_cmplt_ps(a, b); }
+			static M Gt(F a, F b) { return _mm_cmpgt_ps(a, b); }
+			static M Le(F a, F b) { return _mm_cmple_ps(a, b); }
+			static M Ge(F a, F b) { return _mm_cmpge_ps(a, b); }
+			static M Eq(F a, F b) { return _mm_cmpeq_ps(a, b); }
+			static M And(M a, M b) { return _mm_and_ps(a, b); }
+			static M Or(M a, M b) { return _mm_or_ps(a, b); }
+			static M AndNot(M a, M b) { return _mm_andnot_ps(a, b); }
+			static M False() { return _mm_setzero_ps(); }
+			static F Select(M m, F a, F b) { return _mm_blendv_ps(b, a, m); }
+		};
+	}
+
+	void IntegrateRange_SSE4(const ParticleStreams& streams, const ParticleStepParams& params, size_t begin, size_t end)
+	{
+		IntegrateRange<SSE4Ops>(streams, params, begin, end);
+	}
+}
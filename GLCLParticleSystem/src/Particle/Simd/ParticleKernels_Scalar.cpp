@@ -0,0 +1,9 @@
+#include "Particle/Simd/ParticleKernelsImpl.h"
+
+namespace Engine
+{
+	void IntegrateRange_Scalar(const ParticleStreams& streams, const ParticleStepParams& params, size_t begin, size_t end)
+	{
+		IntegrateRange<ScalarOps>(streams, params, begin, end);
+	}
+}
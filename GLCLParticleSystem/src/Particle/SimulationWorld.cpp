@@ -4,10 +4,13 @@
 
 namespace Engine
 {
-	SimulationWorld::SimulationWorld(const glm::vec3& center, const glm::vec3& size)
+	SimulationWorld::SimulationWorld(const glm::vec3& center, const glm::vec3& size, bool headless)
+		:m_Headless(headless)
 	{
 		m_Bounds = new SimulationBounds(center, size);
-		m_BoundsRenderer = new MeshRenderer(PrimitiveType::Box, center, size);
+
+		if (!m_Headless)
+			m_BoundsRenderer = new MeshRenderer(PrimitiveType::Box, center, size);
 	}
 
 	SimulationWorld::~SimulationWorld()
@@ -21,14 +24,17 @@ namespace Engine
 	void SimulationWorld::AddSphere(const glm::vec3& center, float radius)
 	{
 		SimulationSphere* sphere = new SimulationSphere();
-		MeshRenderer* meshRenderer = new MeshRenderer(PrimitiveType::Sphere, center, glm::vec3(1.0f) * radius);
 		sphere->Sphere = glm::vec4(center, radius * 0.5f);
 		m_Spheres.push_back(sphere);
-		m_SphereMeshRenderers.push_back(meshRenderer);
+
+		if (!m_Headless)
+			m_SphereMeshRenderers.push_back(new MeshRenderer(PrimitiveType::Sphere, center, glm::vec3(1.0f) * radius));
 	}
 
 	void SimulationWorld::Render(const glm::mat4& viewProjectionMatrix)
 	{
+		if (m_Headless) return;
+
 		RenderCommand::SetDrawMode(DrawMode::WireFrame);
 
 		if (m_RenderSpheres)
@@ -43,6 +49,8 @@ namespace Engine
 
 	void SimulationWorld::RotateBounds(float amount)
 	{
+		if (m_Headless) return;
+
 		m_BoundsRenderer->Rotate(amount);
 		m_Bounds->SetCenter(m_BoundsRenderer->GetModelMatrix() * glm::vec4(m_Bounds->GetCenter(), 1.0f));
 		m_Bounds->SetMinExtents(m_BoundsRenderer->GetModelMatrix() * glm::vec4(m_Bounds->GetMinExtents(), 1.0f));
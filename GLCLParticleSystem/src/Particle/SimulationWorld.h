@@ -23,7 +23,7 @@ namespace Engine
 	class SimulationWorld
 	{
 	public:
-		SimulationWorld(const glm::vec3& center = glm::vec3(0.0f), const glm::vec3& size = glm::vec3(1.0f));
+		SimulationWorld(const glm::vec3& center = glm::vec3(0.0f), const glm::vec3& size = glm::vec3(1.0f), bool headless = false);
 		~SimulationWorld();
 
 		const SimulationBounds& GetBounds() const { return *m_Bounds; }
@@ -38,7 +38,8 @@ namespace Engine
 
 	private:
 		bool m_RenderSpheres = true;
-		MeshRenderer* m_BoundsRenderer;
+		bool m_Headless = false;
+		MeshRenderer* m_BoundsRenderer = nullptr;
 		SimulationBounds* m_Bounds;
 		std::vector<MeshRenderer*> m_SphereMeshRenderers;
 		std::vector<SimulationSphere*> m_Spheres;
@@ -2,10 +2,14 @@
 #include "Engine/Application.h"
 
 
-int main()
+int main(int argc, char** argv)
 {
+	bool headless = false;
+	for (int i = 1; i < argc; i++)
+		if (strcmp(argv[i], "--headless") == 0)
+			headless = true;
 
-	Engine::Application::Create("Particle System");
+	Engine::Application::Create("Particle System", headless);
 	Engine::Application::Run();
 	Engine::Application::Shutdown();
 }
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "glclpch.h"
+#include "TestCase.h"
+
+#include "Particle/CPUParticleSimulation.h"
+
+#include <cstring>
+
+using namespace Engine;
+
+// Steps the same spawn with every kernel variant the host can run and requires each one to
+// leave the same bits in every stream.  The count is no multiple of any width, so the scalar
+// tails run too, and pulses are queued now and then so their pass is covered.
+TEST_CASE(EveryISAStepsToTheSameBits)
+{
+	const size_t particleCount = 16 * 1024 + 7;
+	const uint32_t seed = 1234;
+
+	SimulationBounds bounds(glm::vec3(0.0f), glm::vec3(1.0f));
+	std::vector<glm::vec4> spheres =
+	{
+		glm::vec4(0.0f, 0.0f, 0.0f, 0.25f),
+		glm::vec4(0.3f, 0.0f, 0.0f, 0.05f),
+		glm::vec4(-0.3f, 0.0f, 0.0f, 0.05f),
+		glm::vec4(0.0f, 0.0f, 0.3f, 0.05f),
+		glm::vec4(0.22f, 0.0f, -0.22f, 0.05f),
+	};
+	ColliderGrid grid;
+	grid.Build(spheres);
+
+	std::vector<float> reference;
+	for (SimdISA isa : { SimdISA::Scalar, SimdISA::SSE4, SimdISA::AVX2, SimdISA::AVX512 })
+	{
+		if (!ParticleKernels::IsSupported(isa))
+			continue;
+
+		CPUParticleSimulation simulation(particleCount);
+		simulation.SetISA(isa);
+		simulation.SetIntegration(0.00125f, -39.2f, 4);
+		simulation.Initialize(glm::vec3(0.0f, 0.3f, 0.0f), 0.2f, glm::vec3(-1.0f), glm::vec3(1.0f), seed);
+		for (uint32_t step = 0; step < 200; step++)
+		{
+			uint32_t pulseCount = step % 50 == 0 ? 2 : 0;
+			simulation.Step(bounds, spheres, grid, step * 0.005f, seed, step + 1, pulseCount);
+		}
+
+		const ParticleStreams& streams = simulation.GetStreams();
+		std::vector<float> state;
+		for (const float* stream : { streams.PositionX, streams.PositionY, streams.PositionZ, streams.VelocityX, streams.VelocityY, streams.VelocityZ, streams.ColorR, streams.ColorG, streams.ColorB })
+			state.insert(state.end(), stream, stream + particleCount);
+
+		if (reference.empty())
+		{
+			reference = state;
+			continue;
+		}
+
+		std::cout << "  " << ParticleKernels::ISAName(isa) << " against Scalar\n";
+		CHECK(std::memcmp(state.data(), reference.data(), state.size() * sizeof(float)) == 0);
+	}
+}
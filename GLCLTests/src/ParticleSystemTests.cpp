@@ -0,0 +1,131 @@
+#include "glclpch.h"
+#include "TestCase.h"
+
+#include "Particle/ParticleSystem.h"
+#include "Engine/Compute/OpenCLContext.h"
+
+#include <cstring>
+
+using namespace Engine;
+
+// The device state as one float4 per particle, streamed back through ReadParticles().
+static std::vector<cl_float4> ReadDeviceAttribute(ParticleSystem& particleSystem, ParticleAttribute attribute)
+{
+	std::vector<cl_float4> values(particleSystem.GetProperties().ParticleCount);
+	particleSystem.ReadParticles(attribute, {}, [&](const ReadbackChunk& chunk)
+		{
+			std::memcpy(values.data() + chunk.FirstElement, chunk.Data, chunk.ElementCount * sizeof(cl_float4));
+		});
+	particleSystem.Synchronize();
+	return values;
+}
+
+static size_t CountMismatches(const std::vector<cl_float4>& device, const float* x, const float* y, const float* z, const char* attribute)
+{
+	size_t mismatches = 0;
+	for (size_t i = 0; i < device.size(); i++)
+	{
+		const float host[3] = { x[i], y[i], z[i] };
+		if (std::memcmp(device[i].s, host, sizeof(host)) == 0)
+			continue;
+
+		if (mismatches++ == 0)
+			std::cout << "  first " << attribute << " mismatch at particle " << i << ": device (" << device[i].s[0] << ", " << device[i].s[1] << ", " << device[i].s[2]
+				<< "), host (" << host[0] << ", " << host[1] << ", " << host[2] << ")\n";
+	}
+	return mismatches;
+}
+
+// Runs one seed, pulses included, on the OpenCL and the CPU backend and requires the same
+// positions and velocities, bit for bit, after every stretch of steps.
+TEST_CASE(BackendsStepToTheSameBits)
+{
+	if (!OpenCLContext::Initialize(false))
+	{
+		Tests::Skip("no usable OpenCL device");
+		return;
+	}
+	if (!OpenCLContext::IsCorrectlyRoundedDivideSqrtSupported())
+	{
+		Tests::Skip("the device can't round divide and sqrt correctly");
+		return;
+	}
+
+	ParticleSystemProperties properties(64 * 1024);
+	properties.Headless = true;
+	properties.MaxFrameCount = 0;
+	properties.Seed = 20240611;
+	properties.Substeps = 2;
+
+	properties.Backend = SimulationBackend::OpenCL;
+	ParticleSystem device(properties, "resources/cl/particle_sim.cl", "");
+	properties.Backend = SimulationBackend::CPU;
+	ParticleSystem host(properties, "", "");
+
+	device.Start();
+	host.Start();
+
+	for (uint32_t stretch = 0; stretch < 4; stretch++)
+	{
+		for (uint32_t step = 0; step < 50; step++)
+		{
+			if (step % 20 == 0)
+			{
+				device.ApplyPulse();
+				host.ApplyPulse();
+			}
+			device.Tick(0.0f);
+			host.Tick(0.0f);
+		}
+
+		const ParticleStreams& streams = host.GetCPUSimulation()->GetStreams();
+		std::vector<cl_float4> positions = ReadDeviceAttribute(device, ParticleAttribute::Position);
+		std::vector<cl_float4> velocities = ReadDeviceAttribute(device, ParticleAttribute::Velocity);
+
+		std::cout << "  after " << (stretch + 1) * 50 << " steps\n";
+		CHECK(CountMismatches(positions, streams.PositionX, streams.PositionY, streams.PositionZ, "position") == 0);
+		CHECK(CountMismatches(velocities, streams.VelocityX, streams.VelocityY, streams.VelocityZ, "velocity") == 0);
+	}
+}
+
+// Ticks a fixed-timestep system at frame rates above, near and below the step rate.  None is a
+// whole number of steps per frame, so the time left over, and with it the interpolation alpha,
+// must move from frame to frame, stay in [0, 1) and never lose real time.
+TEST_CASE(InterpolationAlphaFollowsTheClock)
+{
+	ParticleSystemProperties properties(1024);
+	properties.Headless = true;
+	properties.MaxFrameCount = 0;
+	properties.Backend = SimulationBackend::CPU;
+	properties.FixedTimestep = true;
+	properties.TimeStep = 0.0025f;
+	properties.Substeps = 3;
+
+	for (float frameRate : { 30.0f, 60.0f, 240.0f })
+	{
+		ParticleSystem particleSystem(properties, "", "");
+		particleSystem.Start();
+
+		const float dt = 1.0f / frameRate;
+		float minAlpha = 1.0f, maxAlpha = 0.0f;
+		uint32_t changes = 0;
+		float previous = particleSystem.GetInterpolationAlpha();
+		for (uint32_t frame = 0; frame < 120; frame++)
+		{
+			particleSystem.Tick(dt);
+			float alpha = particleSystem.GetInterpolationAlpha();
+			minAlpha = std::min(minAlpha, alpha);
+			maxAlpha = std::max(maxAlpha, alpha);
+			if (alpha != previous)
+				changes++;
+			previous = alpha;
+		}
+
+		double leftOver = previous * particleSystem.GetStepDuration();
+		std::cout << "  " << frameRate << " Hz: alpha in [" << minAlpha << ", " << maxAlpha << "], changed on " << changes << " of 120 frames\n";
+		CHECK(minAlpha >= 0.0f && maxAlpha < 1.0f);
+		CHECK(maxAlpha - minAlpha > 0.5f);
+		CHECK(changes >= 60);
+		CHECK(std::abs(particleSystem.GetSimulatedTime() + leftOver - 120.0 * dt) < 1e-4);
+	}
+}
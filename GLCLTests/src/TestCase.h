@@ -0,0 +1,33 @@
+#pragma once
+
+namespace Tests
+{
+	using TestFn = void(*)();
+
+	struct TestCase
+	{
+		const char* Name;
+		TestFn Run;
+	};
+
+	// Every TEST_CASE in the binary, in static initialization order.
+	std::vector<TestCase>& GetTestCases();
+
+	struct TestRegistrar
+	{
+		TestRegistrar(const char* name, TestFn run) { GetTestCases().push_back({ name, run }); }
+	};
+
+	// A failed CHECK is counted against the running test, which carries on.
+	void ReportFailure(const char* expression, const char* file, int line);
+	// Marks the running test skipped, e.g. for want of an OpenCL device.  The test should return.
+	void Skip(const std::string& reason);
+}
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static ::Tests::TestRegistrar name##Registrar(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) ::Tests::ReportFailure(#expression, __FILE__, __LINE__); } while (0)
@@ -0,0 +1,70 @@
+#include "glclpch.h"
+#include "TestCase.h"
+
+#include "Engine/Random.h"
+#include "Engine/Compute/OpenCLBinaryCache.h"
+#include "Engine/Threading/JobSystem.h"
+
+namespace Tests
+{
+	static uint32_t s_Failures = 0;
+	static std::string s_SkipReason;
+
+	std::vector<TestCase>& GetTestCases()
+	{
+		static std::vector<TestCase> testCases;
+		return testCases;
+	}
+
+	void ReportFailure(const char* expression, const char* file, int line)
+	{
+		std::cout << "  " << file << "(" << line << "): CHECK(" << expression << ") failed\n";
+		s_Failures++;
+	}
+
+	void Skip(const std::string& reason)
+	{
+		s_SkipReason = reason;
+	}
+}
+
+// Runs every test, or those whose name contains the first argument.  Exits non-zero if any failed.
+int main(int argc, char** argv)
+{
+	using namespace Engine;
+
+	std::string filter = argc > 1 ? argv[1] : "";
+
+	Log::Initialize();
+	Random::Initialize();
+	JobSystem::Initialize();
+	// Every run builds the kernels from source, so a stale binary can't hide a change.
+	OpenCLBinaryCache::SetDirectory("");
+
+	uint32_t passed = 0, failed = 0, skipped = 0;
+	for (const Tests::TestCase& test : Tests::GetTestCases())
+	{
+		if (!filter.empty() && std::string(test.Name).find(filter) == std::string::npos)
+			continue;
+
+		std::cout << test.Name << "\n";
+		uint32_t failures = Tests::s_Failures;
+		Tests::s_SkipReason.clear();
+		test.Run();
+
+		if (Tests::s_Failures != failures)
+			failed++;
+		else if (!Tests::s_SkipReason.empty())
+		{
+			std::cout << "  skipped: " << Tests::s_SkipReason << "\n";
+			skipped++;
+		}
+		else
+			passed++;
+	}
+
+	std::cout << passed << " passed, " << failed << " failed, " << skipped << " skipped\n";
+
+	JobSystem::Shutdown();
+	return failed > 0 ? 1 : 0;
+}
@@ -16,6 +16,43 @@ IncludeDirectories["GLFW"]	= "%{wks.location}/Dependencies/GLFW/include"
 IncludeDirectories["glad"]	= "%{wks.location}/Dependencies/glad/include"
 
 
+-- The SIMD particle kernels are compiled per ISA and selected at runtime, so they
+-- can't share the precompiled header built without those target flags.
+function ParticleKernelFilters()
+	filter "files:**/Particle/Simd/ParticleKernels_*.cpp"
+		flags { "NoPCH" }
+
+	-- Every ISA has to round alike, so nothing may be contracted into an fma.  MSVC before
+	-- VS2022 contracts under /fp:precise when targeting AVX2, and only /fp:strict stops it.
+	filter { "files:**/Particle/Simd/ParticleKernels_*.cpp", "toolset:msc*" }
+		buildoptions { "/fp:strict" }
+
+	filter { "files:**/Particle/Simd/ParticleKernels_*.cpp", "toolset:not msc*" }
+		buildoptions { "-ffp-contract=off" }
+
+	filter { "files:**/Particle/Simd/ParticleKernels_SSE4.cpp", "toolset:not msc*" }
+		buildoptions { "-msse4.1" }
+
+	filter { "files:**/Particle/Simd/ParticleKernels_AVX2.cpp", "toolset:msc*" }
+		buildoptions { "/arch:AVX2" }
+
+	filter { "files:**/Particle/Simd/ParticleKernels_AVX2.cpp", "toolset:not msc*" }
+		buildoptions { "-mavx2" }
+
+	filter { "files:**/Particle/Simd/ParticleKernels_AVX512.cpp", "toolset:msc*" }
+		buildoptions { "/arch:AVX512" }
+
+	filter { "files:**/Particle/Simd/ParticleKernels_AVX512.cpp", "toolset:not msc*" }
+		buildoptions { "-mavx512f" }
+
+	-- The CPU spawn and pulses must round like particle_sim.cl, which turns contraction off.
+	-- MSVC builds this file for plain SSE2, which has no fma to contract into.
+	filter { "files:**/Particle/CPUParticleSimulation.cpp", "toolset:not msc*" }
+		buildoptions { "-ffp-contract=off" }
+
+	filter {}
+end
+
 group "Dependencies"
 	include "Dependencies/GLFW"
 	include "Dependencies/glad"
@@ -69,6 +106,164 @@ project "GLCLParticleSystem"
 	pchheader "glclpch.h"
 	pchsource "%{prj.name}/src/glclpch.cpp"
 
+	ParticleKernelFilters()
+
+	filter "system:windows"
+		systemversion "latest"
+
+	filter "configurations:Debug"
+		defines "GLCL_DEBUG"
+		runtime "Debug"
+		symbols "on"
+
+	filter "configurations:Release"
+		defines "GLCL_RELEASE"
+		runtime "Release"
+		optimize "on"
+
+	filter "configurations:Dist"
+		defines "GLCL_DIST"
+		runtime "Release"
+		optimize "on"
+
+
+project "GLCLBenchmark"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+	location "GLCLBenchmark"
+	debugdir "GLCLParticleSystem"
+
+	targetdir ("bin/" .. outputdir .. "/%{prj.name}")
+	objdir ("bin-int/" .. outputdir .. "/%{prj.name}")
+
+	defines
+	{
+		"_CRT_SECURE_NO_WARNINGS",
+		"GLFW_INCLUDE_NONE"
+	}
+
+	-- Builds the engine sources directly rather than through a library so the simulation
+	-- is compiled exactly as the interactive app compiles it.
+	files
+	{
+		"%{prj.name}/src/**.h",
+		"%{prj.name}/src/**.cpp",
+		"GLCLParticleSystem/src/**.h",
+		"GLCLParticleSystem/src/**.cpp"
+	}
+
+	removefiles
+	{
+		"GLCLParticleSystem/src/main.cpp"
+	}
+
+	includedirs 
+	{
+		"%{prj.name}/src",
+		"GLCLParticleSystem/src",
+		"GLCLParticleSystem/vendor/glm",
+		"GLCLParticleSystem/vendor/spdlog/include",
+		"GLCLParticleSystem/vendor/OpenCL/include",
+		"%{IncludeDirectories.GLFW}",
+		"%{IncludeDirectories.glad}",
+	}
+
+	libdirs
+	{
+		"%{wks.location}/Dependencies/OpenCL"
+	}
+
+	links
+	{
+		"GLFW",
+		"glad",
+		"OpenCL64.lib"
+	}
+
+	pchheader "glclpch.h"
+	pchsource "GLCLParticleSystem/src/glclpch.cpp"
+
+	ParticleKernelFilters()
+
+	filter "system:windows"
+		systemversion "latest"
+
+	filter "configurations:Debug"
+		defines "GLCL_DEBUG"
+		runtime "Debug"
+		symbols "on"
+
+	filter "configurations:Release"
+		defines "GLCL_RELEASE"
+		runtime "Release"
+		optimize "on"
+
+	filter "configurations:Dist"
+		defines "GLCL_DIST"
+		runtime "Release"
+		optimize "on"
+
+
+project "GLCLTests"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+	location "GLCLTests"
+	debugdir "GLCLParticleSystem"
+
+	targetdir ("bin/" .. outputdir .. "/%{prj.name}")
+	objdir ("bin-int/" .. outputdir .. "/%{prj.name}")
+
+	defines
+	{
+		"_CRT_SECURE_NO_WARNINGS",
+		"GLFW_INCLUDE_NONE"
+	}
+
+	-- Builds the engine sources directly, as GLCLBenchmark does, so the tests check the
+	-- simulation as the app compiles it.
+	files
+	{
+		"%{prj.name}/src/**.h",
+		"%{prj.name}/src/**.cpp",
+		"GLCLParticleSystem/src/**.h",
+		"GLCLParticleSystem/src/**.cpp"
+	}
+
+	removefiles
+	{
+		"GLCLParticleSystem/src/main.cpp"
+	}
+
+	includedirs 
+	{
+		"%{prj.name}/src",
+		"GLCLParticleSystem/src",
+		"GLCLParticleSystem/vendor/glm",
+		"GLCLParticleSystem/vendor/spdlog/include",
+		"GLCLParticleSystem/vendor/OpenCL/include",
+		"%{IncludeDirectories.GLFW}",
+		"%{IncludeDirectories.glad}",
+	}
+
+	libdirs
+	{
+		"%{wks.location}/Dependencies/OpenCL"
+	}
+
+	links
+	{
+		"GLFW",
+		"glad",
+		"OpenCL64.lib"
+	}
+
+	pchheader "glclpch.h"
+	pchsource "GLCLParticleSystem/src/glclpch.cpp"
+
+	ParticleKernelFilters()
+
 	filter "system:windows"
 		systemversion "latest"
 